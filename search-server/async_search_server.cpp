@@ -0,0 +1,132 @@
+#include "async_search_server.h"
+
+#include <exception>
+
+using namespace std;
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer& search_server, chrono::microseconds window, size_t max_batch_size)
+	: AsyncSearchServer(search_server, ThreadPool::GetDefault(), window, max_batch_size) {
+}
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer& search_server, ThreadPool& pool, chrono::microseconds window,
+	size_t max_batch_size, size_t max_batches_in_flight)
+	: search_server_(search_server)
+	, pool_(pool)
+	, window_(window)
+	, max_batch_size_(max(size_t{1}, max_batch_size))
+	, max_batches_in_flight_(max_batches_in_flight > 0 ? max_batches_in_flight : pool.GetWorkerCount())
+	, dispatcher_([this] {
+		DispatchLoop();
+	}) {
+}
+
+AsyncSearchServer::~AsyncSearchServer() {
+	{
+		lock_guard lock(mutex_);
+		stop_ = true;
+	}
+	has_requests_.notify_all();
+	dispatcher_.join();
+	// Задачи пула обращаются к объекту, поэтому он живет, пока не завершится последний пакет
+	unique_lock lock(mutex_);
+	batch_done_.wait(lock, [this] {
+		return batches_in_flight_ == 0;
+	});
+}
+
+future<vector<Document>> AsyncSearchServer::SubmitQuery(string raw_query, const DocumentFilter& filter, size_t max_count) {
+	promise<vector<Document>> result;
+	future<vector<Document>> future_result = result.get_future();
+	bool is_batch_ready = false;
+	{
+		lock_guard lock(mutex_);
+		if (pending_.empty()) {
+			batch_start_ = Clock::now();
+		}
+		pending_.push_back({move(raw_query), filter, max_count, move(result)});
+		is_batch_ready = pending_.size() == 1 || pending_.size() >= max_batch_size_;
+	}
+	// Диспетчер ждет либо первый запрос пакета, либо его заполнения
+	if (is_batch_ready) {
+		has_requests_.notify_one();
+	}
+	return future_result;
+}
+
+future<vector<Document>> AsyncSearchServer::SubmitQuery(string raw_query, DocumentStatus status, size_t max_count) {
+	return SubmitQuery(move(raw_query), DocumentFilter().SetStatuses({status}), max_count);
+}
+
+future<vector<Document>> AsyncSearchServer::SubmitQuery(string raw_query) {
+	return SubmitQuery(move(raw_query), DocumentStatus::ACTUAL);
+}
+
+void AsyncSearchServer::DispatchLoop() {
+	while (true) {
+		vector<Request> batch;
+		{
+			unique_lock lock(mutex_);
+			has_requests_.wait(lock, [this] {
+				return stop_ || !pending_.empty();
+			});
+			if (pending_.empty()) {
+				return;
+			}
+			// Пока пакеты ждали свободного места, окно нового могло уже истечь
+			has_requests_.wait_until(lock, batch_start_ + window_, [this] {
+				return stop_ || pending_.size() >= max_batch_size_;
+			});
+			batch_done_.wait(lock, [this] {
+				return batches_in_flight_ < max_batches_in_flight_;
+			});
+			const size_t batch_size = min(pending_.size(), max_batch_size_);
+			batch.assign(make_move_iterator(pending_.begin()), make_move_iterator(pending_.begin() + batch_size));
+			pending_.erase(pending_.begin(), pending_.begin() + batch_size);
+			// Остаток пришел, пока набирался полный пакет: он уйдет следующим без ожидания
+			if (!pending_.empty()) {
+				batch_start_ = Clock::now() - window_;
+			}
+			++batches_in_flight_;
+		}
+		pool_.Post([this, batch = move(batch)](QueryContext&) mutable {
+			ProcessBatch(batch);
+			// Уведомление под мьютексом: после его освобождения деструктор может уничтожить объект
+			lock_guard lock(mutex_);
+			--batches_in_flight_;
+			batch_done_.notify_all();
+		});
+	}
+}
+
+void AsyncSearchServer::ProcessBatch(vector<Request>& batch) const {
+	// Некорректный запрос получает свою ошибку и не мешает остальным
+	vector<PreparedQuery> prepared;
+	vector<Request*> accepted;
+	prepared.reserve(batch.size());
+	for (Request& request : batch) {
+		try {
+			prepared.push_back(search_server_.PrepareQuery(request.raw_query));
+			accepted.push_back(&request);
+		} catch (...) {
+			request.result.set_exception(current_exception());
+		}
+	}
+
+	vector<BatchQuery> queries;
+	queries.reserve(accepted.size());
+	for (size_t i = 0; i < accepted.size(); ++i) {
+		queries.push_back({&prepared[i], accepted[i]->filter, accepted[i]->max_count});
+	}
+	vector<vector<Document>> results;
+	try {
+		results = search_server_.FindTopDocumentsBatch(queries);
+	} catch (...) {
+		for (Request* request : accepted) {
+			request->result.set_exception(current_exception());
+		}
+		return;
+	}
+	for (size_t i = 0; i < accepted.size(); ++i) {
+		accepted[i]->result.set_value(move(results[i]));
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "search_server.h"
+#include "thread_pool.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Асинхронные запросы к серверу. Запросы, пришедшие из разных потоков за короткое окно времени,
+// собираются в пакет и выполняются одним FindTopDocumentsBatch: общие слова запросов
+// читаются из индекса один раз. Первый запрос пакета ждет не дольше window, полный пакет
+// отправляется сразу. Поток-диспетчер только собирает пакеты и передает их задачами в пул;
+// одновременно выполняется не больше max_batches_in_flight пакетов (по умолчанию - по числу
+// рабочих пула). Пока все места заняты, следующий пакет продолжает набираться.
+//
+// search_server не должен изменяться, пока существует объект
+class AsyncSearchServer {
+public:
+	// Пакеты выполняются в ThreadPool::GetDefault()
+	explicit AsyncSearchServer(const SearchServer& search_server,
+		std::chrono::microseconds window = std::chrono::microseconds(200), size_t max_batch_size = 64);
+	AsyncSearchServer(const SearchServer& search_server, ThreadPool& pool,
+		std::chrono::microseconds window = std::chrono::microseconds(200), size_t max_batch_size = 64,
+		size_t max_batches_in_flight = 0);
+	// Дожидается выполнения уже принятых запросов
+	~AsyncSearchServer();
+
+	AsyncSearchServer(const AsyncSearchServer&) = delete;
+	AsyncSearchServer& operator=(const AsyncSearchServer&) = delete;
+
+	// Ошибка разбора запроса приходит через future
+	std::future<std::vector<Document>> SubmitQuery(std::string raw_query, const DocumentFilter& filter,
+		size_t max_count = MAX_RESULT_DOCUMENT_COUNT);
+	std::future<std::vector<Document>> SubmitQuery(std::string raw_query, DocumentStatus status,
+		size_t max_count = MAX_RESULT_DOCUMENT_COUNT);
+	std::future<std::vector<Document>> SubmitQuery(std::string raw_query);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Request {
+		std::string raw_query;
+		DocumentFilter filter;
+		size_t max_count;
+		std::promise<std::vector<Document>> result;
+	};
+
+	const SearchServer& search_server_;
+	ThreadPool& pool_;
+	const std::chrono::microseconds window_;
+	const size_t max_batch_size_;
+	const size_t max_batches_in_flight_;
+
+	std::mutex mutex_;
+	std::condition_variable has_requests_;
+	// Пакет, выполненный в пуле, освобождает место для следующего
+	std::condition_variable batch_done_;
+	size_t batches_in_flight_ = 0;
+	std::vector<Request> pending_;
+	// Когда пришел первый запрос из pending_
+	Clock::time_point batch_start_;
+	bool stop_ = false;
+	std::thread dispatcher_;
+
+	void DispatchLoop();
+	void ProcessBatch(std::vector<Request>& batch) const;
+};
@@ -0,0 +1,452 @@
+// Набор замеров производительности поискового сервера.
+// Каждый замер печатается отдельной строкой JSON, чтобы результаты разных версий можно было сравнивать скриптом.
+// Замеры запускаются по одному в отдельных процессах: память, занятая одним замером, не попадает в следующий.
+//
+// Параметры (все необязательные): --documents=10000 --vocabulary=1000 --max-word-length=10
+// --document-words=70 --queries=100 --query-words=70 --minus-prob=0 --repeat=3 --seed=0 --cases=add,find_seq,...
+// --posting-format=plain|compressed --shards=4 --workers=<число ядер>
+
+#include "search_server.h"
+#include "async_search_server.h"
+#include "process_queries.h"
+#include "result_cache.h"
+#include "sharded_search_server.h"
+#include "generators.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <execution>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+using namespace std;
+
+namespace {
+
+// Все замеры в порядке запуска
+const vector<string> CASE_NAMES = {
+    "add", "add_bulk",
+    "find_seq", "find_context", "find_batch", "find_async", "find_cached", "find_par", "find_pool", "find_sharded",
+    "find_seq_predicate", "find_par_predicate",
+    "match", "match_batch",
+    "remove",
+    "process_queries", "process_queries_pool", "process_queries_stream", "process_queries_joined",
+};
+
+struct BenchmarkConfig {
+    int document_count = 10'000;
+    int vocabulary_size = 1'000;
+    int max_word_length = 10;
+    int document_word_count = 70;
+    int query_count = 100;
+    int query_word_count = 70;
+    double minus_prob = 0.0;
+    int repeat = 3;
+    unsigned seed = 0;
+    PostingFormat posting_format = PostingFormat::PLAIN;
+    int shard_count = 4;
+    int worker_count = max(1u, thread::hardware_concurrency());
+    set<string> cases;
+};
+
+struct Corpus {
+    vector<string> dictionary;
+    vector<string> documents;
+    vector<string> queries;
+};
+
+// Поле VmRSS или VmHWM (пик VmRSS) из /proc/self/status
+long GetProcessMemoryKb(string_view field) {
+    ifstream status("/proc/self/status");
+    for (string line; getline(status, line);) {
+        if (line.compare(0, field.size(), field) == 0 && line.size() > field.size() && line[field.size()] == ':') {
+            return stol(line.substr(field.size() + 1));
+        }
+    }
+    return 0;
+}
+
+// Сбрасывает VmHWM до текущего VmRSS. Если ядро этого не позволяет, пик считается от старта процесса
+void ResetPeakRss() {
+    ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+}
+
+BenchmarkConfig ParseConfig(int argc, char* argv[]) {
+    BenchmarkConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const string_view arg = argv[i];
+        const size_t eq = arg.find('=');
+        if (arg.substr(0, 2) != "--"sv || eq == arg.npos) {
+            throw invalid_argument("Expected --name=value, got "s + string(arg));
+        }
+        const string_view name = arg.substr(2, eq - 2);
+        const string value(arg.substr(eq + 1));
+        if (name == "documents"sv) {
+            config.document_count = stoi(value);
+        } else if (name == "vocabulary"sv) {
+            config.vocabulary_size = stoi(value);
+        } else if (name == "max-word-length"sv) {
+            config.max_word_length = stoi(value);
+        } else if (name == "document-words"sv) {
+            config.document_word_count = stoi(value);
+        } else if (name == "queries"sv) {
+            config.query_count = stoi(value);
+        } else if (name == "query-words"sv) {
+            config.query_word_count = stoi(value);
+        } else if (name == "minus-prob"sv) {
+            config.minus_prob = stod(value);
+        } else if (name == "repeat"sv) {
+            config.repeat = max(1, stoi(value));
+        } else if (name == "seed"sv) {
+            config.seed = stoul(value);
+        } else if (name == "posting-format"sv) {
+            if (value == "plain"s) {
+                config.posting_format = PostingFormat::PLAIN;
+            } else if (value == "compressed"s) {
+                config.posting_format = PostingFormat::COMPRESSED;
+            } else {
+                throw invalid_argument("Unknown posting format "s + value);
+            }
+        } else if (name == "shards"sv) {
+            config.shard_count = max(1, stoi(value));
+        } else if (name == "workers"sv) {
+            config.worker_count = max(1, stoi(value));
+        } else if (name == "cases"sv) {
+            istringstream cases(value);
+            for (string name; getline(cases, name, ',');) {
+                if (find(CASE_NAMES.begin(), CASE_NAMES.end(), name) == CASE_NAMES.end()) {
+                    throw invalid_argument("Unknown case "s + name);
+                }
+                config.cases.insert(name);
+            }
+        } else {
+            throw invalid_argument("Unknown option "s + string(name));
+        }
+    }
+    return config;
+}
+
+Corpus GenerateCorpus(const BenchmarkConfig& config) {
+    mt19937 generator(config.seed);
+    Corpus corpus;
+    corpus.dictionary = GenerateDictionary(generator, config.vocabulary_size, config.max_word_length);
+    corpus.documents = GenerateQueries(generator, corpus.dictionary, config.document_count, config.document_word_count);
+    corpus.queries = GenerateQueries(generator, corpus.dictionary, config.query_count, config.query_word_count, config.minus_prob);
+    return corpus;
+}
+
+void FillServer(SearchServer& search_server, const Corpus& corpus, PostingFormat posting_format) {
+    search_server.SetPostingFormat(posting_format);
+    for (size_t i = 0; i < corpus.documents.size(); ++i) {
+        search_server.AddDocument(i, corpus.documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+}
+
+// Запускает эту же программу с теми же параметрами для каждого выбранного замера отдельно
+int RunCasesInSeparateProcesses(int argc, char* argv[], const BenchmarkConfig& config) {
+    vector<string> args;
+    for (int i = 0; i < argc; ++i) {
+        if (i == 0 || string_view(argv[i]).substr(0, 8) != "--cases="sv) {
+            args.push_back(argv[i]);
+        }
+    }
+    args.emplace_back();
+    for (const string& name : CASE_NAMES) {
+        if (!config.cases.empty() && config.cases.count(name) == 0) {
+            continue;
+        }
+        args.back() = "--cases="s + name;
+        vector<char*> child_argv;
+        for (string& arg : args) {
+            child_argv.push_back(arg.data());
+        }
+        child_argv.push_back(nullptr);
+        cout.flush();
+        pid_t pid;
+        if (posix_spawn(&pid, "/proc/self/exe", nullptr, nullptr, child_argv.data(), environ) != 0) {
+            cerr << "Cannot start case " << name << endl;
+            return 1;
+        }
+        int status = 0;
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            cerr << "Case " << name << " failed" << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+class BenchmarkRunner {
+public:
+    BenchmarkRunner(const BenchmarkConfig& config, const Corpus& corpus)
+        : config_(config)
+        , corpus_(corpus) {
+    }
+
+    // body(setup_state) выполняет operations операций, каждая обрабатывает documents_per_op документов.
+    // Из повторов берется лучшее время: оно меньше всего зависит от шума.
+    template <typename Setup, typename Body>
+    void Run(const string& name, size_t operations, double documents_per_op, Setup setup, Body body) {
+        if (!config_.cases.empty() && config_.cases.count(name) == 0) {
+            return;
+        }
+        // Пик памяти считается только по этому замеру, вместе с подготовкой состояния
+        ResetPeakRss();
+        const long start_rss_kb = GetProcessMemoryKb("VmRSS"sv);
+        double best_seconds = numeric_limits<double>::infinity();
+        double checksum = 0;
+        for (int i = 0; i < config_.repeat; ++i) {
+            auto state = setup();
+            const auto start = chrono::steady_clock::now();
+            checksum = body(state);
+            const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+            best_seconds = min(best_seconds, elapsed.count());
+        }
+        const long peak_rss_kb = GetProcessMemoryKb("VmHWM"sv);
+        cout << "{\"case\":\"" << name << "\""
+             << ",\"documents\":" << config_.document_count
+             << ",\"vocabulary\":" << corpus_.dictionary.size()
+             << ",\"query_words\":" << config_.query_word_count
+             << ",\"minus_prob\":" << config_.minus_prob
+             << ",\"ops\":" << operations
+             << ",\"ns_per_op\":" << best_seconds * 1e9 / max<size_t>(operations, 1)
+             << ",\"docs_per_sec\":" << operations * documents_per_op / best_seconds
+             << ",\"peak_rss_kb\":" << peak_rss_kb
+             << ",\"case_rss_kb\":" << max(0L, peak_rss_kb - start_rss_kb)
+             << ",\"checksum\":" << checksum << "}" << endl;
+    }
+
+private:
+    const BenchmarkConfig& config_;
+    const Corpus& corpus_;
+};
+
+template <typename ExecutionPolicy>
+double SumTopRelevance(const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy policy, bool with_predicate) {
+    double total_relevance = 0;
+    for (const string& query : queries) {
+        const auto documents = with_predicate
+            ? search_server.FindTopDocuments(policy, query, [](int document_id, DocumentStatus, int) {
+                return document_id % 2 == 0;
+            })
+            : search_server.FindTopDocuments(policy, query);
+        for (const Document& document : documents) {
+            total_relevance += document.relevance;
+        }
+    }
+    return total_relevance;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    BenchmarkConfig config;
+    try {
+        config = ParseConfig(argc, argv);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    if (config.cases.size() != 1) {
+        return RunCasesInSeparateProcesses(argc, argv, config);
+    }
+    const Corpus corpus = GenerateCorpus(config);
+    const string& stop_words = corpus.dictionary[0];
+    BenchmarkRunner runner(config, corpus);
+
+    // Для замеров только на чтение индекс строится один раз
+    SearchServer search_server(stop_words);
+    FillServer(search_server, corpus, config.posting_format);
+    const size_t corpus_size = corpus.documents.size();
+    const size_t query_count = corpus.queries.size();
+    const auto no_setup = [] {
+        return 0;
+    };
+
+    runner.Run("add", corpus_size, 1, [&] {
+        return make_unique<SearchServer>(stop_words);
+    }, [&](unique_ptr<SearchServer>& server) {
+        FillServer(*server, corpus, config.posting_format);
+        return static_cast<double>(server->GetDocumentCount());
+    });
+    runner.Run("add_bulk", corpus_size, 1, [&] {
+        auto server = make_unique<SearchServer>(stop_words);
+        server->SetPostingFormat(config.posting_format);
+        vector<NewDocument> documents(corpus_size);
+        for (size_t i = 0; i < corpus_size; ++i) {
+            documents[i] = {static_cast<int>(i), corpus.documents[i], DocumentStatus::ACTUAL, {1, 2, 3}};
+        }
+        return make_pair(move(server), move(documents));
+    }, [&](pair<unique_ptr<SearchServer>, vector<NewDocument>>& state) {
+        state.first->AddDocuments(state.second);
+        return static_cast<double>(state.first->GetDocumentCount());
+    });
+
+    runner.Run("find_seq", query_count, corpus_size, no_setup, [&](int) {
+        return SumTopRelevance(search_server, corpus.queries, execution::seq, false);
+    });
+    runner.Run("find_context", query_count, corpus_size, [] {
+        return QueryContext();
+    }, [&](QueryContext& context) {
+        double total_relevance = 0;
+        for (const string& query : corpus.queries) {
+            for (const Document& document : search_server.FindTopDocuments(context, query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        return total_relevance;
+    });
+    runner.Run("find_batch", query_count, corpus_size, no_setup, [&](int) {
+        vector<PreparedQuery> prepared;
+        vector<BatchQuery> batch;
+        prepared.reserve(query_count);
+        for (const string& query : corpus.queries) {
+            prepared.push_back(search_server.PrepareQuery(query));
+            batch.push_back({&prepared.back(), DocumentFilter().SetStatuses({DocumentStatus::ACTUAL}), MAX_RESULT_DOCUMENT_COUNT});
+        }
+        double total_relevance = 0;
+        for (const auto& documents : search_server.FindTopDocumentsBatch(batch)) {
+            for (const Document& document : documents) {
+                total_relevance += document.relevance;
+            }
+        }
+        return total_relevance;
+    });
+    runner.Run("find_async", query_count, corpus_size, no_setup, [&](int) {
+        AsyncSearchServer async_server(search_server);
+        vector<future<vector<Document>>> results;
+        for (const string& query : corpus.queries) {
+            results.push_back(async_server.SubmitQuery(query));
+        }
+        double total_relevance = 0;
+        for (auto& result : results) {
+            for (const Document& document : result.get()) {
+                total_relevance += document.relevance;
+            }
+        }
+        return total_relevance;
+    });
+    // Каждый запрос повторяется CACHED_QUERY_REPEAT раз, как в потоке с частыми одинаковыми запросами
+    const size_t CACHED_QUERY_REPEAT = 10;
+    runner.Run("find_cached", query_count * CACHED_QUERY_REPEAT, corpus_size, [&] {
+        return make_unique<ResultCache>(query_count * 4);
+    }, [&](unique_ptr<ResultCache>& cache) {
+        double total_relevance = 0;
+        for (size_t i = 0; i < CACHED_QUERY_REPEAT; ++i) {
+            for (const string& query : corpus.queries) {
+                for (const Document& document : cache->FindTopDocuments(search_server, query)) {
+                    total_relevance += document.relevance;
+                }
+            }
+        }
+        return total_relevance;
+    });
+    runner.Run("find_par", query_count, corpus_size, no_setup, [&](int) {
+        return SumTopRelevance(search_server, corpus.queries, execution::par, false);
+    });
+    ThreadPool pool(config.worker_count);
+    runner.Run("find_pool", query_count, corpus_size, no_setup, [&](int) {
+        return SumTopRelevance(search_server, corpus.queries, pool.GetPolicy(), false);
+    });
+    runner.Run("find_sharded", query_count, corpus_size, [&] {
+        auto server = make_unique<ShardedSearchServer>(stop_words, config.shard_count);
+        server->SetPostingFormat(config.posting_format);
+        for (size_t i = 0; i < corpus.documents.size(); ++i) {
+            server->AddDocument(i, corpus.documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        return server;
+    }, [&](unique_ptr<ShardedSearchServer>& server) {
+        double total_relevance = 0;
+        for (const string& query : corpus.queries) {
+            for (const Document& document : server->FindTopDocuments(query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        return total_relevance;
+    });
+    runner.Run("find_seq_predicate", query_count, corpus_size, no_setup, [&](int) {
+        return SumTopRelevance(search_server, corpus.queries, execution::seq, true);
+    });
+    runner.Run("find_par_predicate", query_count, corpus_size, no_setup, [&](int) {
+        return SumTopRelevance(search_server, corpus.queries, execution::par, true);
+    });
+
+    const size_t match_document_count = min<size_t>(corpus_size, 100);
+    runner.Run("match", query_count * match_document_count, 1, no_setup, [&](int) {
+        double matched_words = 0;
+        for (const string& query : corpus.queries) {
+            for (size_t document_id = 0; document_id < match_document_count; ++document_id) {
+                matched_words += get<0>(search_server.MatchDocument(query, document_id)).size();
+            }
+        }
+        return matched_words;
+    });
+
+    runner.Run("match_batch", query_count * match_document_count, 1, [&] {
+        vector<int> document_ids(match_document_count);
+        iota(document_ids.begin(), document_ids.end(), 0);
+        return document_ids;
+    }, [&](const vector<int>& document_ids) {
+        double matched_words = 0;
+        for (const string& query : corpus.queries) {
+            for (const auto& [words, status] : search_server.MatchDocuments(query, document_ids)) {
+                matched_words += words.size();
+            }
+        }
+        return matched_words;
+    });
+
+    runner.Run("remove", corpus_size, 1, [&] {
+        auto server = make_unique<SearchServer>(stop_words);
+        FillServer(*server, corpus, config.posting_format);
+        return server;
+    }, [&](unique_ptr<SearchServer>& server) {
+        for (size_t document_id = 0; document_id < corpus_size; ++document_id) {
+            server->RemoveDocument(document_id);
+        }
+        return static_cast<double>(server->GetDocumentCount());
+    });
+
+    runner.Run("process_queries", query_count, corpus_size, no_setup, [&](int) {
+        double result_count = 0;
+        for (const auto& documents : ProcessQueries(search_server, corpus.queries)) {
+            result_count += documents.size();
+        }
+        return result_count;
+    });
+    runner.Run("process_queries_pool", query_count, corpus_size, no_setup, [&](int) {
+        double result_count = 0;
+        for (const auto& documents : ProcessQueries(pool, search_server, corpus.queries)) {
+            result_count += documents.size();
+        }
+        return result_count;
+    });
+    runner.Run("process_queries_stream", query_count, corpus_size, no_setup, [&](int) {
+        double result_count = 0;
+        ProcessQueriesStream(pool, search_server, corpus.queries, ResultOrder::ORDERED,
+            [&](size_t, const vector<Document>& documents) {
+                result_count += documents.size();
+            });
+        return result_count;
+    });
+    runner.Run("process_queries_joined", query_count, corpus_size, no_setup, [&](int) {
+        return static_cast<double>(ProcessQueriesJoined(search_server, corpus.queries).size());
+    });
+}
@@ -0,0 +1,42 @@
+#include "document_bitmap.h"
+
+#include <algorithm>
+
+using namespace std;
+
+DocumentBitmap::DocumentBitmap(vector<uint32_t> document_indexes) {
+	sort(document_indexes.begin(), document_indexes.end());
+	document_indexes.erase(unique(document_indexes.begin(), document_indexes.end()), document_indexes.end());
+	size_ = document_indexes.size();
+
+	for (auto begin = document_indexes.begin(); begin != document_indexes.end();) {
+		const uint32_t key = *begin >> 16;
+		const auto end = upper_bound(begin, document_indexes.end(), (key << 16) | 0xFFFFu);
+		if (container_by_key_.size() <= key) {
+			container_by_key_.resize(key + 1, NO_CONTAINER);
+		}
+		container_by_key_[key] = containers_.size();
+
+		Container& container = containers_.emplace_back();
+		if (static_cast<size_t>(end - begin) <= MAX_ARRAY_SIZE) {
+			container.values.reserve(end - begin);
+			for (auto it = begin; it != end; ++it) {
+				container.values.push_back(static_cast<uint16_t>(*it));
+			}
+		} else {
+			container.bits.resize(65536 / 64);
+			for (auto it = begin; it != end; ++it) {
+				const uint16_t value = static_cast<uint16_t>(*it);
+				container.bits[value / 64] |= uint64_t{1} << (value % 64);
+			}
+		}
+		begin = end;
+	}
+}
+
+bool DocumentBitmap::Container::Contains(uint16_t value) const {
+	if (!bits.empty()) {
+		return ((bits[value / 64] >> (value % 64)) & 1) != 0;
+	}
+	return binary_search(values.begin(), values.end(), value);
+}
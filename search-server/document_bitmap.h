@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Сжатое множество внутренних индексов документов в духе roaring bitmap.
+// Старшие 16 бит индекса выбирают контейнер, младшие хранятся в нем: разреженный контейнер -
+// отсортированный массив, плотный - битовая карта на 65536 значений.
+class DocumentBitmap {
+public:
+	DocumentBitmap() = default;
+	explicit DocumentBitmap(std::vector<uint32_t> document_indexes);
+
+	bool Contains(uint32_t document_index) const {
+		const uint32_t key = document_index >> 16;
+		if (key >= container_by_key_.size() || container_by_key_[key] == NO_CONTAINER) {
+			return false;
+		}
+		return containers_[container_by_key_[key]].Contains(static_cast<uint16_t>(document_index));
+	}
+
+	size_t size() const {
+		return size_;
+	}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+
+private:
+	static constexpr uint32_t NO_CONTAINER = ~0u;
+	// Массив из 4096 значений занимает столько же, сколько битовая карта
+	static constexpr size_t MAX_ARRAY_SIZE = 4096;
+
+	struct Container {
+		std::vector<uint16_t> values;
+		std::vector<uint64_t> bits;
+
+		bool Contains(uint16_t value) const;
+	};
+
+	std::vector<Container> containers_;
+	std::vector<uint32_t> container_by_key_;
+	size_t size_ = 0;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "string_processing.h"
+
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+
+// Декларативный фильтр документов: набор допустимых статусов и диапазон рейтинга.
+// В отличие от лямбды-предиката сервер может проверить его сразу по всем документам.
+struct DocumentFilter {
+	static constexpr uint32_t ANY_STATUS = ~0u;
+
+	uint32_t status_mask = ANY_STATUS;
+	int min_rating = std::numeric_limits<int>::min();
+	int max_rating = std::numeric_limits<int>::max();
+
+	DocumentFilter& SetStatuses(std::initializer_list<DocumentStatus> statuses) {
+		status_mask = 0;
+		for (const DocumentStatus status : statuses) {
+			status_mask |= StatusBit(status);
+		}
+		return *this;
+	}
+
+	DocumentFilter& SetRatingRange(int min, int max) {
+		min_rating = min;
+		max_rating = max;
+		return *this;
+	}
+
+	bool Matches(DocumentStatus status, int rating) const {
+		return (status_mask & StatusBit(status)) != 0 && rating >= min_rating && rating <= max_rating;
+	}
+
+	static uint32_t StatusBit(DocumentStatus status) {
+		return 1u << static_cast<uint32_t>(status);
+	}
+};
@@ -0,0 +1,60 @@
+#include "document_text_arena.h"
+
+#include <algorithm>
+#include <iterator>
+
+using namespace std;
+
+DocumentTextArena::DocumentTextArena(const DocumentTextArena& other)
+	: chunks_(other.chunks_)
+	, live_bytes_(other.live_bytes_)
+	, free_bytes_(other.free_bytes_) {
+}
+
+string_view DocumentTextArena::Store(string_view text) {
+	if (text.empty()) {
+		return {};
+	}
+	Chunk* chunk = current_;
+	if (chunk == nullptr || chunk->used + text.size() > chunk->capacity) {
+		const size_t capacity = max(CHUNK_SIZE, text.size());
+		shared_ptr<char[]> data(new char[capacity]);
+		const char* key = data.get();
+		chunk = &chunks_[key];
+		chunk->data = move(data);
+		chunk->capacity = capacity;
+		// Текст больше блока получает отдельный блок, текущий блок продолжает заполняться
+		if (capacity == CHUNK_SIZE) {
+			current_ = chunk;
+		}
+	}
+	char* data = chunk->data.get() + chunk->used;
+	copy(text.begin(), text.end(), data);
+	chunk->used += text.size();
+	chunk->live += text.size();
+	live_bytes_ += text.size();
+	return {data, text.size()};
+}
+
+void DocumentTextArena::Release(string_view text) {
+	if (text.empty()) {
+		return;
+	}
+	const auto it = prev(chunks_.upper_bound(text.data()));
+	Chunk& chunk = it->second;
+	chunk.live -= text.size();
+	live_bytes_ -= text.size();
+	if (chunk.live > 0) {
+		free_bytes_ += text.size();
+		return;
+	}
+	free_bytes_ -= chunk.used - text.size();
+	if (&chunk == current_ && chunk.data.use_count() == 1) {
+		chunk.used = 0;
+		return;
+	}
+	if (&chunk == current_) {
+		current_ = nullptr;
+	}
+	chunks_.erase(it);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string_view>
+
+// Тексты документов в крупных блоках вместо отдельной строки на каждый документ.
+// Адреса сохраненных текстов не меняются, пока блок жив. Освобожденные байты учитываются
+// по блокам: опустевший блок сразу возвращается системе, а частично занятые блоки
+// освобождает только копирующее уплотнение на стороне владельца текстов.
+class DocumentTextArena {
+public:
+	DocumentTextArena() = default;
+	// Копия разделяет блоки с оригиналом. Блок, который видит кто-то еще, не переиспользуется,
+	// а новые тексты копия пишет в собственный блок
+	DocumentTextArena(const DocumentTextArena& other);
+	DocumentTextArena(DocumentTextArena&&) = default;
+	DocumentTextArena& operator=(DocumentTextArena&&) = default;
+
+	std::string_view Store(std::string_view text);
+	void Release(std::string_view text);
+
+	// Байты живых текстов
+	size_t GetLiveBytes() const {
+		return live_bytes_;
+	}
+
+	// Байты удаленных текстов, которые еще занимают память в частично живых блоках
+	size_t GetFreeBytes() const {
+		return free_bytes_;
+	}
+
+private:
+	static constexpr size_t CHUNK_SIZE = 1024 * 1024;
+
+	struct Chunk {
+		std::shared_ptr<char[]> data;
+		size_t capacity = 0;
+		size_t used = 0;
+		size_t live = 0;
+	};
+
+	// Ключ - адрес начала блока, чтобы по string_view найти его владельца
+	std::map<const char*, Chunk> chunks_;
+	Chunk* current_ = nullptr;
+	size_t live_bytes_ = 0;
+	size_t free_bytes_ = 0;
+};
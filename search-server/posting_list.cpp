@@ -0,0 +1,230 @@
+#include "posting_list.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+constexpr size_t LANE_COUNT = 4;
+static_assert(PostingList::BLOCK_SIZE % LANE_COUNT == 0);
+
+// Разности блока раскладываются по четырем полосам: разность i лежит в полосе i % 4
+// на месте i / 4, а слова полос чередуются. Так одна строка из четырех разностей
+// распаковывается общими для всех полос сдвигами
+size_t GetRowCount(size_t count) {
+	return (count + LANE_COUNT - 1) / LANE_COUNT;
+}
+
+size_t GetPackedWordCount(size_t count, uint32_t bit_width) {
+	return (GetRowCount(count) * bit_width + 31) / 32 * LANE_COUNT;
+}
+
+// Распаковывает row_count строк ширины bit_width > 0 в out[0, 4 * row_count)
+void UnpackRows(const uint32_t* words, uint32_t bit_width, size_t row_count, uint32_t* out) {
+#ifdef __SSE2__
+	const __m128i mask = _mm_set1_epi32(static_cast<int>(bit_width == 32 ? ~0u : (1u << bit_width) - 1));
+	const __m128i* in = reinterpret_cast<const __m128i*>(words);
+	__m128i current = _mm_loadu_si128(in);
+	uint32_t shift = 0;
+	for (size_t row = 0; row < row_count; ++row) {
+		__m128i value = _mm_srl_epi32(current, _mm_cvtsi32_si128(static_cast<int>(shift)));
+		shift += bit_width;
+		if (shift >= 32) {
+			shift -= 32;
+			++in;
+			if (shift > 0) {
+				// Старшие биты строки лежат в следующем слове полосы
+				current = _mm_loadu_si128(in);
+				value = _mm_or_si128(value, _mm_sll_epi32(current, _mm_cvtsi32_si128(static_cast<int>(bit_width - shift))));
+			} else if (row + 1 < row_count) {
+				current = _mm_loadu_si128(in);
+			}
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + row * LANE_COUNT), _mm_and_si128(value, mask));
+	}
+#else
+	const uint64_t mask = (uint64_t{1} << bit_width) - 1;
+	for (size_t i = 0; i < row_count * LANE_COUNT; ++i) {
+		const size_t bit = i / LANE_COUNT * bit_width;
+		const size_t shift = bit % 32;
+		const uint32_t* lane_words = words + i % LANE_COUNT;
+		uint64_t value = lane_words[bit / 32 * LANE_COUNT] >> shift;
+		if (shift + bit_width > 32) {
+			value |= uint64_t{lane_words[(bit / 32 + 1) * LANE_COUNT]} << (32 - shift);
+		}
+		out[i] = static_cast<uint32_t>(value & mask);
+	}
+#endif
+}
+
+// Превращает разности в индексы: out[i] = out[0] + ... + out[i].
+// Массив дополнен нулями до кратного четырем размера
+void PrefixSum(uint32_t* values, size_t count) {
+#ifdef __SSE2__
+	__m128i carry = _mm_setzero_si128();
+	for (size_t i = 0; i < count; i += 4) {
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+		x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+		x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+		x = _mm_add_epi32(x, carry);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), x);
+		carry = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+#else
+	for (size_t i = 1; i < count; ++i) {
+		values[i] += values[i - 1];
+	}
+#endif
+}
+
+}  // namespace
+
+void PostingList::Add(uint32_t document_index, double term_freq) {
+	if (!empty() && GetLastDocumentIndex() == document_index) {
+		term_freqs_.back() += term_freq;
+	} else {
+		tail_.push_back(document_index);
+		term_freqs_.push_back(term_freq);
+		// Последнее вхождение остается в хвосте, чтобы повторное слово документа
+		// не требовало распаковки блока
+		if (compressed_ && tail_.size() > BLOCK_SIZE) {
+			SealBlocks(1);
+		}
+	}
+	max_term_freq_ = max(max_term_freq_, term_freqs_.back());
+}
+
+void PostingList::Reserve(size_t count) {
+	term_freqs_.reserve(count);
+	if (!compressed_) {
+		tail_.reserve(count);
+	}
+}
+
+void PostingList::Assign(const uint32_t* document_indexes, const double* term_freqs, size_t count) {
+	blocks_.clear();
+	packed_.clear();
+	tail_.assign(document_indexes, document_indexes + count);
+	term_freqs_.assign(term_freqs, term_freqs + count);
+	max_term_freq_ = count == 0 ? 0.0 : *max_element(term_freqs_.begin(), term_freqs_.end());
+	if (compressed_) {
+		SealBlocks(0);
+		tail_.shrink_to_fit();
+	}
+}
+
+void PostingList::SetCompressed(bool compressed) {
+	if (compressed_ == compressed) {
+		return;
+	}
+	compressed_ = compressed;
+	if (compressed_) {
+		SealBlocks(0);
+		tail_.shrink_to_fit();
+		return;
+	}
+	vector<uint32_t> document_indexes(term_freqs_.size());
+	auto out = document_indexes.begin();
+	array<uint32_t, BLOCK_SIZE> buffer;
+	for (size_t block = 0; block < blocks_.size(); ++block) {
+		DecodeBlock(block, buffer.data());
+		out = copy(buffer.begin(), buffer.begin() + blocks_[block].count, out);
+	}
+	copy(tail_.begin(), tail_.end(), out);
+	tail_ = move(document_indexes);
+	blocks_.clear();
+	blocks_.shrink_to_fit();
+	packed_.clear();
+	packed_.shrink_to_fit();
+}
+
+PostingList::const_iterator PostingList::LowerBound(uint32_t document_index) const {
+	const auto block_it = lower_bound(blocks_.begin(), blocks_.end(), document_index,
+		[](const Block& block, uint32_t index) {
+			return block.last_document_index < index;
+		});
+	const_iterator it(this, block_it - blocks_.begin());
+	it.pos_ = lower_bound(it.document_indexes_, it.document_indexes_ + it.count_, document_index) - it.document_indexes_;
+	return it;
+}
+
+void PostingList::SkipTo(const_iterator& it, uint32_t document_index) const {
+	if (it.block_ < blocks_.size() && blocks_[it.block_].last_document_index < document_index) {
+		const auto block_it = lower_bound(blocks_.begin() + it.block_ + 1, blocks_.end(), document_index,
+			[](const Block& block, uint32_t index) {
+				return block.last_document_index < index;
+			});
+		it.Load(block_it - blocks_.begin());
+	}
+	it.pos_ = lower_bound(it.document_indexes_ + it.pos_, it.document_indexes_ + it.count_, document_index) - it.document_indexes_;
+}
+
+size_t PostingList::GetMemoryUsage() const {
+	return blocks_.size() * sizeof(Block) + (packed_.size() + tail_.size()) * sizeof(uint32_t)
+		+ term_freqs_.size() * sizeof(double);
+}
+
+void PostingList::SealBlocks(size_t keep_in_tail) {
+	const size_t posting_base = term_freqs_.size() - tail_.size();
+	size_t sealed = 0;
+	while (tail_.size() - sealed >= keep_in_tail + BLOCK_SIZE) {
+		Block block;
+		block.posting_offset = posting_base + sealed;
+		block.packed_offset = packed_.size();
+		const vector<uint32_t> words = EncodeBlock(tail_.data() + sealed, BLOCK_SIZE, block);
+		packed_.insert(packed_.end(), words.begin(), words.end());
+		blocks_.push_back(block);
+		sealed += BLOCK_SIZE;
+	}
+	tail_.erase(tail_.begin(), tail_.begin() + sealed);
+}
+
+void PostingList::DecodeBlock(size_t block, uint32_t* document_indexes) const {
+	const Block& header = blocks_[block];
+	const size_t row_count = GetRowCount(header.count);
+	if (header.bit_width == 0) {
+		fill(document_indexes, document_indexes + row_count * LANE_COUNT, 0);
+	} else {
+		UnpackRows(packed_.data() + header.packed_offset, header.bit_width, row_count, document_indexes);
+	}
+	// На месте нулевой разности начинается префиксная сумма, а хвост последней строки
+	// заполнен нулевыми разностями
+	document_indexes[0] = header.first_document_index;
+	PrefixSum(document_indexes, row_count * LANE_COUNT);
+}
+
+vector<uint32_t> PostingList::EncodeBlock(const uint32_t* document_indexes, size_t count, Block& block) const {
+	uint32_t max_delta = 0;
+	for (size_t i = 1; i < count; ++i) {
+		max_delta = max(max_delta, document_indexes[i] - document_indexes[i - 1]);
+	}
+	uint32_t bit_width = 0;
+	while (bit_width < 32 && (max_delta >> bit_width) != 0) {
+		++bit_width;
+	}
+
+	// Разность с номером 0 всегда нулевая: так строки полос выровнены по началу блока
+	vector<uint32_t> words(GetPackedWordCount(count, bit_width));
+	for (size_t i = 1; i < count; ++i) {
+		const uint32_t delta = document_indexes[i] - document_indexes[i - 1];
+		const size_t bit = i / LANE_COUNT * bit_width;
+		const size_t shift = bit % 32;
+		uint32_t* lane_words = words.data() + i % LANE_COUNT;
+		lane_words[bit / 32 * LANE_COUNT] |= delta << shift;
+		if (shift + bit_width > 32) {
+			lane_words[(bit / 32 + 1) * LANE_COUNT] |= delta >> (32 - shift);
+		}
+	}
+	block.first_document_index = document_indexes[0];
+	block.last_document_index = document_indexes[count - 1];
+	block.bit_width = static_cast<uint8_t>(bit_width);
+	block.count = static_cast<uint8_t>(count);
+	return words;
+}
+
+uint32_t PostingList::GetLastDocumentIndex() const {
+	return tail_.empty() ? blocks_.back().last_document_index : tail_.back();
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+struct Posting {
+	uint32_t document_index;
+	double term_freq;
+};
+
+// Список вхождений слова, отсортированный по внутреннему индексу документа.
+// Индексы выдаются по возрастанию при добавлении, поэтому вставка всегда идет в конец.
+// Максимальная частота слова - верхняя оценка для отсечения документов при ранжировании;
+// после удаления документов она может только завышать реальный максимум.
+//
+// Частоты лежат отдельным массивом, индексы документов - в несжатом хвосте.
+// В сжатом режиме каждые BLOCK_SIZE индексов хвоста упаковываются в блок: разности соседних
+// индексов записываются минимальным общим числом бит, чередуясь по четырем полосам.
+// По последнему индексу блока LowerBound пропускает блоки целиком, а итератор распаковывает
+// по одному блоку за раз: с SSE2 и биты разностей, и их префиксная сумма обрабатываются
+// по четыре значения.
+class PostingList {
+public:
+	static constexpr uint32_t BLOCK_SIZE = 128;
+
+	class const_iterator;
+
+	void Add(uint32_t document_index, double term_freq);
+	void Reserve(size_t count);
+	// Заменяет содержимое готовыми массивами: индексы строго возрастают
+	void Assign(const uint32_t* document_indexes, const double* term_freqs, size_t count);
+
+	// Переключение формата перекодирует уже накопленные вхождения
+	void SetCompressed(bool compressed);
+
+	bool IsCompressed() const {
+		return compressed_;
+	}
+
+	const_iterator LowerBound(uint32_t document_index) const;
+	// Сдвигает итератор к первому вхождению с индексом не меньше document_index.
+	// Итератор меняется на месте и распаковывает блок, только если поиск ушел за текущий
+	void SkipTo(const_iterator& it, uint32_t document_index) const;
+
+	double GetMaxTermFreq() const {
+		return max_term_freq_;
+	}
+
+	const_iterator begin() const;
+	const_iterator end() const;
+
+	size_t size() const {
+		return term_freqs_.size();
+	}
+
+	bool empty() const {
+		return term_freqs_.empty();
+	}
+
+	// Байты, занятые индексами и частотами без учета резерва векторов
+	size_t GetMemoryUsage() const;
+
+private:
+	struct Block {
+		uint32_t first_document_index;
+		uint32_t last_document_index;
+		uint32_t packed_offset;
+		uint32_t posting_offset;
+		uint8_t bit_width;
+		uint8_t count;
+	};
+
+	void SealBlocks(size_t keep_in_tail);
+	void DecodeBlock(size_t block, uint32_t* document_indexes) const;
+	std::vector<uint32_t> EncodeBlock(const uint32_t* document_indexes, size_t count, Block& block) const;
+	uint32_t GetLastDocumentIndex() const;
+
+	bool compressed_ = false;
+	std::vector<Block> blocks_;
+	std::vector<uint32_t> packed_;
+	std::vector<uint32_t> tail_;
+	std::vector<double> term_freqs_;
+	double max_term_freq_ = 0.0;
+};
+
+class PostingList::const_iterator {
+public:
+	struct ArrowProxy {
+		Posting posting;
+
+		const Posting* operator->() const {
+			return &posting;
+		}
+	};
+
+	const_iterator() = default;
+
+	const_iterator(const const_iterator& other) {
+		*this = other;
+	}
+
+	const_iterator& operator=(const const_iterator& other) {
+		list_ = other.list_;
+		block_ = other.block_;
+		pos_ = other.pos_;
+		count_ = other.count_;
+		term_freqs_ = other.term_freqs_;
+		if (other.document_indexes_ == other.buffer_.data()) {
+			std::copy(other.buffer_.begin(), other.buffer_.begin() + count_, buffer_.begin());
+			document_indexes_ = buffer_.data();
+		} else {
+			document_indexes_ = other.document_indexes_;
+		}
+		return *this;
+	}
+
+	Posting operator*() const {
+		return {document_indexes_[pos_], term_freqs_[pos_]};
+	}
+
+	ArrowProxy operator->() const {
+		return {**this};
+	}
+
+	const_iterator& operator++() {
+		if (++pos_ == count_ && block_ < list_->blocks_.size()) {
+			Load(block_ + 1);
+		}
+		return *this;
+	}
+
+	bool operator==(const const_iterator& other) const {
+		return block_ == other.block_ && pos_ == other.pos_;
+	}
+
+	bool operator!=(const const_iterator& other) const {
+		return !(*this == other);
+	}
+
+private:
+	friend class PostingList;
+
+	const_iterator(const PostingList* list, size_t block)
+		: list_(list) {
+		Load(block);
+	}
+
+	// Номер блока, равный числу блоков, обозначает несжатый хвост
+	void Load(size_t block) {
+		block_ = block;
+		pos_ = 0;
+		if (block_ < list_->blocks_.size()) {
+			const Block& header = list_->blocks_[block_];
+			list_->DecodeBlock(block_, buffer_.data());
+			document_indexes_ = buffer_.data();
+			count_ = header.count;
+			term_freqs_ = list_->term_freqs_.data() + header.posting_offset;
+		} else {
+			document_indexes_ = list_->tail_.data();
+			count_ = list_->tail_.size();
+			term_freqs_ = list_->term_freqs_.data() + (list_->term_freqs_.size() - count_);
+		}
+	}
+
+	const PostingList* list_ = nullptr;
+	size_t block_ = 0;
+	size_t pos_ = 0;
+	size_t count_ = 0;
+	const uint32_t* document_indexes_ = nullptr;
+	const double* term_freqs_ = nullptr;
+	std::array<uint32_t, BLOCK_SIZE> buffer_;
+};
+
+inline PostingList::const_iterator PostingList::begin() const {
+	return {this, 0};
+}
+
+inline PostingList::const_iterator PostingList::end() const {
+	const_iterator it(this, blocks_.size());
+	it.pos_ = it.count_;
+	return it;
+}
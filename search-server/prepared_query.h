@@ -0,0 +1,52 @@
+#pragma once
+
+#include "query_context.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class SearchServer;
+
+// Запрос, разобранный заранее: id слов без повторов и их IDF на момент подготовки.
+// Объект неизменяемый, поэтому его можно использовать из нескольких потоков. После изменения
+// индекса сервер считает его устаревшим и разбирает сохраненный текст заново, так что
+// результаты всегда совпадают с запросом по тексту. Запрос с IDF вызывающего так заново
+// не разобрать: устаревший, он отклоняется исключением, и его нужно подготовить снова.
+class PreparedQuery {
+public:
+	std::string_view GetText() const {
+		return text_;
+	}
+
+	// SearchServer::GetInstanceId сервера, который подготовил запрос
+	uint64_t GetServerId() const {
+		return server_id_;
+	}
+
+	uint64_t GetGeneration() const {
+		return generation_;
+	}
+
+	// IDF заданы вызывающим (SearchServer::PrepareQuery с функцией IDF)
+	bool HasExternalInverseDocumentFreqs() const {
+		return has_external_inverse_document_freqs_;
+	}
+
+	// Слова индекса без повторов в порядке текста; стоп-слова и неизвестные индексу слова отброшены
+	const ParsedQuery& GetQuery() const {
+		return query_;
+	}
+
+private:
+	friend class SearchServer;
+
+	std::string text_;
+	uint64_t server_id_ = 0;
+	uint64_t generation_ = 0;
+	bool has_external_inverse_document_freqs_ = false;
+	ParsedQuery query_;
+	// IDF слов query_.plus_terms в том же порядке
+	std::vector<double> inverse_document_freqs_;
+};
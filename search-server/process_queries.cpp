@@ -2,26 +2,65 @@
 
 #include <execution>
 #include <algorithm>
+#include <numeric>
 
 std::vector<std::vector<Document>> ProcessQueries(
+	const SearchServer& search_server,
+	const std::vector<std::string>& queries) {
+	return ProcessQueries(ThreadPool::GetDefault(), search_server, queries);
+}
+
+std::vector<std::vector<Document>> ProcessQueries(
+	ThreadPool& pool,
 	const SearchServer& search_server,
 	const std::vector<std::string>& queries) {
 	std::vector<std::vector<Document>> process_queries(queries.size());
-	std::transform(std::execution::par, queries.begin(), queries.end(), 
-	process_queries.begin(), [&search_server](const std::string& query) {
-		return search_server.FindTopDocuments(query); });
-    return process_queries;
+	pool.ParallelFor(queries.size(), [&](size_t i, QueryContext& context) {
+		process_queries[i] = search_server.FindTopDocuments(context, queries[i]);
+	});
+	return process_queries;
+}
+
+std::vector<std::vector<Document>> ProcessQueries(
+	ThreadPool& pool,
+	const SearchServer& search_server,
+	const std::vector<std::string>& queries,
+	ResultCache& cache) {
+	std::vector<std::vector<Document>> process_queries(queries.size());
+	pool.ParallelFor(queries.size(), [&](size_t i, QueryContext& context) {
+		process_queries[i] = cache.FindTopDocuments(context, search_server, queries[i],
+			DocumentFilter().SetStatuses({DocumentStatus::ACTUAL}));
+	});
+	return process_queries;
+}
+
+std::vector<Document> ProcessQueriesJoined(
+	const SearchServer& search_server,
+	const std::vector<std::string>& queries) {
+	return ProcessQueriesJoined(ThreadPool::GetDefault(), search_server, queries);
 }
 
 std::vector<Document> ProcessQueriesJoined(
+	ThreadPool& pool,
 	const SearchServer& search_server,
 	const std::vector<std::string>& queries){
-	std::vector<Document> queries_joined;
-	std::vector<std::vector<Document>> process_queries = ProcessQueries(search_server, queries);
-	for (size_t i = 0; i < queries.size(); i++) {
-		for (const Document doc: process_queries.at(i)) {
-        	queries_joined.push_back(doc);
-		}
-	}
+	// Число результатов запроса известно только после его выполнения. Сначала запрос i пишет
+	// результаты в черновой буфер, начиная с i * MAX_RESULT_DOCUMENT_COUNT, и запоминает их число.
+	// По числам считаются смещения, итоговый вектор выделяется ровно под сумму,
+	// и участки параллельно переносятся каждый на свое место
+	std::vector<Document> slots(queries.size() * MAX_RESULT_DOCUMENT_COUNT);
+	std::vector<size_t> offsets(queries.size() + 1);
+	pool.ParallelFor(queries.size(), [&](size_t i, QueryContext& context) {
+		const std::vector<Document>& documents = search_server.FindTopDocuments(context, queries[i]);
+		std::copy(documents.begin(), documents.end(), slots.begin() + i * MAX_RESULT_DOCUMENT_COUNT);
+		offsets[i + 1] = documents.size();
+	});
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+	std::vector<Document> queries_joined(offsets.back());
+	pool.ParallelFor(queries.size(), [&](size_t i, QueryContext&) {
+		const auto slot = slots.begin() + i * MAX_RESULT_DOCUMENT_COUNT;
+		std::copy(slot, slot + (offsets[i + 1] - offsets[i]), queries_joined.begin() + offsets[i]);
+	});
 	return queries_joined;
-} 
\ No newline at end of file
+}
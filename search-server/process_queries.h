@@ -1,15 +1,102 @@
 #pragma once
 
 #include "request_queue.h"
+#include "thread_pool.h"
 
+#include <mutex>
 #include <vector>
 #include <string>
 
+// Сколько запросов упорядоченный поток результатов держит в памяти одновременно
+const size_t PROCESS_QUERIES_BLOCK_SIZE = 1024;
 
+enum class ResultOrder {
+	// В порядке запросов: запросы выполняются блоками, результаты блока отдаются по порядку
+	ORDERED,
+	// По мере готовности, прямо из рабочих потоков пула
+	UNORDERED,
+};
+
+// Запросы выполняются задачами пула, каждая на контексте своего рабочего.
+// Без пула используется ThreadPool::GetDefault()
+std::vector<std::vector<Document>> ProcessQueries(
+		const SearchServer& search_server,
+		const std::vector<std::string>& queries);
 std::vector<std::vector<Document>> ProcessQueries(
+		ThreadPool& pool,
 		const SearchServer& search_server,
 		const std::vector<std::string>& queries);
+// Повторные запросы берутся из cache
+std::vector<std::vector<Document>> ProcessQueries(
+		ThreadPool& pool,
+		const SearchServer& search_server,
+		const std::vector<std::string>& queries,
+		ResultCache& cache);
+
+// Результаты без промежуточного вектора векторов: sink(query_index, documents) вызывается
+// для каждого запроса, documents действителен только во время вызова.
+// Вызовы sink не пересекаются по времени, так что синхронизировать его не нужно
+template <typename Sink>
+void ProcessQueriesStream(
+		const SearchServer& search_server,
+		const std::vector<std::string>& queries,
+		ResultOrder order,
+		Sink sink);
+template <typename Sink>
+void ProcessQueriesStream(
+		ThreadPool& pool,
+		const SearchServer& search_server,
+		const std::vector<std::string>& queries,
+		ResultOrder order,
+		Sink sink);
 
+// Результаты всех запросов подряд. Каждый запрос пишет в свой участок чернового буфера
+// по верхней оценке числа результатов; по числам результатов итоговый вектор выделяется
+// ровно под их сумму и заполняется параллельно. Вектора векторов нет
+std::vector<Document> ProcessQueriesJoined(
+		const SearchServer& search_server,
+		const std::vector<std::string>& queries);
 std::vector<Document> ProcessQueriesJoined(
+		ThreadPool& pool,
 		const SearchServer& search_server,
-		const std::vector<std::string>& queries); 
\ No newline at end of file
+		const std::vector<std::string>& queries);
+
+template <typename Sink>
+void ProcessQueriesStream(
+	const SearchServer& search_server,
+	const std::vector<std::string>& queries,
+	ResultOrder order,
+	Sink sink) {
+	ProcessQueriesStream(ThreadPool::GetDefault(), search_server, queries, order, sink);
+}
+
+template <typename Sink>
+void ProcessQueriesStream(
+	ThreadPool& pool,
+	const SearchServer& search_server,
+	const std::vector<std::string>& queries,
+	ResultOrder order,
+	Sink sink) {
+	if (order == ResultOrder::UNORDERED) {
+		std::mutex sink_mutex;
+		pool.ParallelFor(queries.size(), [&](size_t i, QueryContext& context) {
+			const std::vector<Document>& documents = search_server.FindTopDocuments(context, queries[i]);
+			std::lock_guard guard(sink_mutex);
+			sink(i, documents);
+		});
+		return;
+	}
+
+	// Буферы блока переиспользуются, поэтому память не растет с числом запросов
+	std::vector<std::vector<Document>> block(std::min(queries.size(), PROCESS_QUERIES_BLOCK_SIZE));
+	for (size_t block_begin = 0; block_begin < queries.size(); block_begin += block.size()) {
+		const size_t block_size = std::min(block.size(), queries.size() - block_begin);
+		pool.ParallelFor(block_size, [&](size_t i, QueryContext& context) {
+			const std::vector<Document>& documents = search_server.FindTopDocuments(context, queries[block_begin + i]);
+			block[i].assign(documents.begin(), documents.end());
+		});
+		for (size_t i = 0; i < block_size; ++i) {
+			sink(block_begin + i, block[i]);
+		}
+	}
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "document.h"
+#include "posting_list.h"
+#include "term_dictionary.h"
+#include "top_documents.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Разобранный запрос: id слов индекса. Слов, которых в индексе нет, здесь уже нет
+struct ParsedQuery {
+	std::vector<TermId> plus_terms;
+	std::vector<TermId> minus_terms;
+};
+
+// Рабочие буферы одного запроса: разобранные слова, накопители релевантности, битовые маски
+// и результат. Контекст можно хранить между запросами (например, по одному на поток):
+// буферы дорастают до нужного размера за первые вызовы, после чего запросы не выделяют память.
+// Одновременно использовать один контекст из нескольких потоков нельзя.
+//
+// Плотные массивы занимают около 9 байт на документ самого большого индекса, по которому искали
+// через контекст. Хранимые контексты - контекст потока (ThreadQueryContext) и контексты рабочих
+// ThreadPool - после запроса освобождают их, если они больше GetRetainedBytesLimit():
+// поиск по очень большому индексу тогда выделяет массивы на каждый запрос, зато поток
+// не держит память бессрочно. 0 - не хранить массивы совсем, SIZE_MAX - хранить всегда.
+class QueryContext {
+public:
+	static constexpr size_t DEFAULT_RETAINED_BYTES_LIMIT = 64 * 1024 * 1024;
+
+	QueryContext()
+		: top_documents_(0) {
+	}
+
+	static void SetRetainedBytesLimit(size_t bytes) {
+		retained_bytes_limit_.store(bytes, std::memory_order_relaxed);
+	}
+	static size_t GetRetainedBytesLimit() {
+		return retained_bytes_limit_.load(std::memory_order_relaxed);
+	}
+
+	// Память плотных массивов по документам
+	size_t GetDenseBytes() const {
+		return relevance_.capacity() * sizeof(double) + is_matched_.capacity() * sizeof(char)
+			+ matched_indexes_.capacity() * sizeof(uint32_t)
+			+ (excluded_.capacity() + filter_bitmap_.capacity()) * sizeof(uint64_t);
+	}
+	// Освобождает плотные массивы, если они больше GetRetainedBytesLimit()
+	void TrimDenseBuffers() {
+		if (GetDenseBytes() > GetRetainedBytesLimit()) {
+			relevance_ = std::vector<double>();
+			is_matched_ = std::vector<char>();
+			matched_indexes_ = std::vector<uint32_t>();
+			excluded_ = std::vector<uint64_t>();
+			filter_bitmap_ = std::vector<uint64_t>();
+		}
+	}
+
+private:
+	friend class SearchServer;
+
+	static inline std::atomic<size_t> retained_bytes_limit_{DEFAULT_RETAINED_BYTES_LIMIT};
+
+	struct TermCursor {
+		const PostingList* postings;
+		PostingList::const_iterator it;
+		double inverse_document_freq;
+		double max_score;
+	};
+
+	std::vector<std::string_view> words_;
+	ParsedQuery query_;
+	// IDF слов query_.plus_terms в том же порядке
+	std::vector<double> inverse_document_freqs_;
+	// Плотные массивы по внутренним индексам документов; между запросами они обнулены
+	std::vector<double> relevance_;
+	std::vector<char> is_matched_;
+	std::vector<uint32_t> matched_indexes_;
+	std::vector<uint64_t> excluded_;
+	std::vector<uint64_t> filter_bitmap_;
+	std::vector<TermCursor> cursors_;
+	std::vector<double> max_score_sums_;
+	TopDocuments top_documents_;
+	std::vector<Document> result_;
+	std::vector<std::string_view> matched_words_;
+	bool is_ranking_ = false;
+};
+
+// Контекст потока для перегрузок SearchServer без явного контекста: плотные массивы выделяются
+// один раз на поток и дорастают до размера самого большого индекса, по которому он искал,
+// но не больше QueryContext::GetRetainedBytesLimit() - сверх него они освобождаются после запроса.
+// Запрос, вызванный из предиката другого запроса, получает временный контекст
+class ThreadQueryContext {
+public:
+	ThreadQueryContext()
+		: is_own_(!is_busy_) {
+		if (is_own_) {
+			is_busy_ = true;
+		} else {
+			temporary_ = std::make_unique<QueryContext>();
+		}
+	}
+
+	ThreadQueryContext(const ThreadQueryContext&) = delete;
+	ThreadQueryContext& operator=(const ThreadQueryContext&) = delete;
+
+	~ThreadQueryContext() {
+		if (is_own_) {
+			context_.TrimDenseBuffers();
+			is_busy_ = false;
+		}
+	}
+
+	QueryContext& Get() {
+		return is_own_ ? context_ : *temporary_;
+	}
+
+	// Память плотных массивов контекста текущего потока
+	static size_t GetThreadDenseBytes() {
+		return context_.GetDenseBytes();
+	}
+
+private:
+	static inline thread_local QueryContext context_;
+	static inline thread_local bool is_busy_ = false;
+
+	bool is_own_;
+	std::unique_ptr<QueryContext> temporary_;
+};
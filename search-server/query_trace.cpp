@@ -0,0 +1,166 @@
+#include "query_trace.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+#ifdef SEARCH_SERVER_TRACING
+
+// Блоки живых потоков и накопленные счетчики завершившихся. Реестр не разрушается,
+// чтобы потоки, которые завершаются после main, могли из него выписаться
+struct TraceRegistry {
+	std::mutex mutex;
+	vector<ThreadTrace*> threads;
+	TraceSnapshot retired;
+	TraceSnapshot baseline;
+};
+
+TraceRegistry& GetRegistry() {
+	static TraceRegistry* registry = new TraceRegistry;
+	return *registry;
+}
+
+void AddThreadTrace(const ThreadTrace& trace, TraceSnapshot& snapshot) {
+	for (size_t i = 0; i < TRACE_STAGE_COUNT; ++i) {
+		TraceStageStats& stats = snapshot.stages[i];
+		stats.calls += trace.calls[i].load(memory_order_relaxed);
+		stats.total_time += chrono::nanoseconds(trace.total_ns[i].load(memory_order_relaxed));
+		stats.max_time = max(stats.max_time, chrono::nanoseconds(trace.max_ns[i].load(memory_order_relaxed)));
+	}
+	for (size_t i = 0; i < TRACE_COUNTER_COUNT; ++i) {
+		snapshot.counters[i] += trace.counters[i].load(memory_order_relaxed);
+	}
+}
+
+TraceSnapshot CollectTraceLocked(TraceRegistry& registry) {
+	TraceSnapshot snapshot = registry.retired;
+	for (const ThreadTrace* trace : registry.threads) {
+		AddThreadTrace(*trace, snapshot);
+	}
+	return snapshot;
+}
+
+// Владелец блока потока: при завершении потока переносит его счетчики в реестр
+struct ThreadTraceHolder {
+	ThreadTrace trace;
+
+	ThreadTraceHolder() {
+		TraceRegistry& registry = GetRegistry();
+		lock_guard guard(registry.mutex);
+		registry.threads.push_back(&trace);
+	}
+
+	~ThreadTraceHolder() {
+		TraceRegistry& registry = GetRegistry();
+		lock_guard guard(registry.mutex);
+		AddThreadTrace(trace, registry.retired);
+		registry.threads.erase(find(registry.threads.begin(), registry.threads.end(), &trace));
+		current_thread_trace = nullptr;
+	}
+};
+
+#endif
+
+}  // namespace
+
+#ifdef SEARCH_SERVER_TRACING
+
+ThreadTrace& RegisterThreadTrace() {
+	thread_local ThreadTraceHolder holder;
+	current_thread_trace = &holder.trace;
+	return holder.trace;
+}
+
+TraceSnapshot CollectTrace() {
+	TraceRegistry& registry = GetRegistry();
+	lock_guard guard(registry.mutex);
+	TraceSnapshot snapshot = CollectTraceLocked(registry);
+	// Максимумы сбрасываются в самих блоках, суммы - вычитанием снимка на момент ResetTrace
+	for (size_t i = 0; i < TRACE_STAGE_COUNT; ++i) {
+		snapshot.stages[i].calls -= registry.baseline.stages[i].calls;
+		snapshot.stages[i].total_time -= registry.baseline.stages[i].total_time;
+	}
+	for (size_t i = 0; i < TRACE_COUNTER_COUNT; ++i) {
+		snapshot.counters[i] -= registry.baseline.counters[i];
+	}
+	return snapshot;
+}
+
+void ResetTrace() {
+	TraceRegistry& registry = GetRegistry();
+	lock_guard guard(registry.mutex);
+	for (ThreadTrace* trace : registry.threads) {
+		for (auto& max_ns : trace->max_ns) {
+			max_ns.store(0, memory_order_relaxed);
+		}
+	}
+	for (TraceStageStats& stats : registry.retired.stages) {
+		stats.max_time = chrono::nanoseconds(0);
+	}
+	registry.baseline = CollectTraceLocked(registry);
+}
+
+void SetTraceTimersEnabled(bool enabled) {
+	trace_timers_enabled.store(enabled, memory_order_relaxed);
+}
+
+#else
+
+TraceSnapshot CollectTrace() {
+	return {};
+}
+
+void ResetTrace() {
+}
+
+void SetTraceTimersEnabled(bool) {
+}
+
+#endif
+
+string_view GetTraceName(TraceStage stage) {
+	switch (stage) {
+	case TraceStage::PARSE_QUERY:
+		return "parse_query"sv;
+	case TraceStage::POSTINGS:
+		return "postings"sv;
+	case TraceStage::FILTER:
+		return "filter"sv;
+	case TraceStage::MINUS_WORDS:
+		return "minus_words"sv;
+	case TraceStage::TOP_DOCUMENTS:
+		return "top_documents"sv;
+	case TraceStage::MATCH_DOCUMENT:
+		return "match_document"sv;
+	}
+	return "unknown"sv;
+}
+
+string_view GetTraceName(TraceCounter counter) {
+	switch (counter) {
+	case TraceCounter::POSTINGS_SCANNED:
+		return "postings_scanned"sv;
+	case TraceCounter::DOCUMENTS_SCORED:
+		return "documents_scored"sv;
+	case TraceCounter::MAX_SCORE_WINDOWS:
+		return "max_score_windows"sv;
+	}
+	return "unknown"sv;
+}
+
+std::ostream& operator<<(std::ostream& out, const TraceSnapshot& snapshot) {
+	for (size_t i = 0; i < TRACE_STAGE_COUNT; ++i) {
+		const TraceStageStats& stats = snapshot.stages[i];
+		out << GetTraceName(static_cast<TraceStage>(i)) << ": calls "sv << stats.calls
+			<< ", total "sv << stats.total_time.count() << " ns, max "sv << stats.max_time.count() << " ns\n"sv;
+	}
+	for (size_t i = 0; i < TRACE_COUNTER_COUNT; ++i) {
+		out << GetTraceName(static_cast<TraceCounter>(i)) << ": "sv << snapshot.counters[i] << '\n';
+	}
+	return out;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+// Счетчики и таймеры этапов обработки запроса. Включаются макросом SEARCH_SERVER_TRACING,
+// который должен быть одинаково задан для всех единиц трансляции; без него макросы TRACE_*
+// не генерируют кода, а CollectTrace возвращает нули.
+//
+// Каждый поток пишет в собственный блок счетчиков без блокировок. Суммы пишет только владелец
+// блока, поэтому они обходятся без атомарных read-modify-write операций. Максимум обновляется
+// через compare_exchange: его обнуляет и ResetTrace из другого потока, и обычная пара
+// чтение-запись могла бы вернуть значение, записанное до сброса. CollectTrace суммирует блоки
+// всех потоков, включая завершившиеся.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+enum class TraceStage {
+	PARSE_QUERY,
+	// Обход списка вхождений одного слова запроса
+	POSTINGS,
+	// Построение битовой маски фильтра
+	FILTER,
+	MINUS_WORDS,
+	TOP_DOCUMENTS,
+	MATCH_DOCUMENT,
+};
+
+enum class TraceCounter {
+	POSTINGS_SCANNED,
+	// Документы, для которых посчитана релевантность
+	DOCUMENTS_SCORED,
+	// Окна MaxScore с вхождениями обязательных слов
+	MAX_SCORE_WINDOWS,
+};
+
+constexpr size_t TRACE_STAGE_COUNT = static_cast<size_t>(TraceStage::MATCH_DOCUMENT) + 1;
+constexpr size_t TRACE_COUNTER_COUNT = static_cast<size_t>(TraceCounter::MAX_SCORE_WINDOWS) + 1;
+
+struct TraceStageStats {
+	uint64_t calls = 0;
+	// Только при включенных таймерах
+	std::chrono::nanoseconds total_time{0};
+	std::chrono::nanoseconds max_time{0};
+};
+
+struct TraceSnapshot {
+	std::array<TraceStageStats, TRACE_STAGE_COUNT> stages{};
+	std::array<uint64_t, TRACE_COUNTER_COUNT> counters{};
+
+	const TraceStageStats& operator[](TraceStage stage) const {
+		return stages[static_cast<size_t>(stage)];
+	}
+	uint64_t operator[](TraceCounter counter) const {
+		return counters[static_cast<size_t>(counter)];
+	}
+};
+
+std::string_view GetTraceName(TraceStage stage);
+std::string_view GetTraceName(TraceCounter counter);
+std::ostream& operator<<(std::ostream& out, const TraceSnapshot& snapshot);
+
+// Сумма по всем потокам с последнего ResetTrace
+TraceSnapshot CollectTrace();
+void ResetTrace();
+// Таймеры стоят два чтения часов на этап; без них считается только число вызовов
+void SetTraceTimersEnabled(bool enabled);
+
+#ifdef SEARCH_SERVER_TRACING
+
+// Блок счетчиков потока. Пишет только сам поток, читает CollectTrace; max_ns еще и обнуляет ResetTrace
+struct ThreadTrace {
+	std::array<std::atomic<uint64_t>, TRACE_STAGE_COUNT> calls{};
+	std::array<std::atomic<uint64_t>, TRACE_STAGE_COUNT> total_ns{};
+	std::array<std::atomic<uint64_t>, TRACE_STAGE_COUNT> max_ns{};
+	std::array<std::atomic<uint64_t>, TRACE_COUNTER_COUNT> counters{};
+};
+
+inline thread_local ThreadTrace* current_thread_trace = nullptr;
+inline std::atomic<bool> trace_timers_enabled{true};
+
+// Регистрирует блок текущего потока при первом обращении
+ThreadTrace& RegisterThreadTrace();
+
+inline ThreadTrace& GetThreadTrace() {
+	return current_thread_trace != nullptr ? *current_thread_trace : RegisterThreadTrace();
+}
+
+inline void AddTraceValue(std::atomic<uint64_t>& value, uint64_t delta) {
+	value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+inline void AddTraceCount(TraceCounter counter, uint64_t value) {
+	AddTraceValue(GetThreadTrace().counters[static_cast<size_t>(counter)], value);
+}
+
+class TraceStageTimer {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	explicit TraceStageTimer(TraceStage stage)
+		: stage_(static_cast<size_t>(stage))
+		, is_timed_(trace_timers_enabled.load(std::memory_order_relaxed)) {
+		if (is_timed_) {
+			start_ = Clock::now();
+		}
+	}
+
+	~TraceStageTimer() {
+		ThreadTrace& trace = GetThreadTrace();
+		AddTraceValue(trace.calls[stage_], 1);
+		if (!is_timed_) {
+			return;
+		}
+		const uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_).count();
+		AddTraceValue(trace.total_ns[stage_], elapsed);
+		std::atomic<uint64_t>& max_ns = trace.max_ns[stage_];
+		uint64_t current_max = max_ns.load(std::memory_order_relaxed);
+		while (elapsed > current_max && !max_ns.compare_exchange_weak(current_max, elapsed, std::memory_order_relaxed)) {
+		}
+	}
+
+	TraceStageTimer(const TraceStageTimer&) = delete;
+	TraceStageTimer& operator=(const TraceStageTimer&) = delete;
+
+private:
+	const size_t stage_;
+	const bool is_timed_;
+	Clock::time_point start_;
+};
+
+#define TRACE_CONCAT_INTERNAL(X, Y) X##Y
+#define TRACE_CONCAT(X, Y) TRACE_CONCAT_INTERNAL(X, Y)
+// Замеряет этап до конца текущей области видимости
+#define TRACE_STAGE(stage) TraceStageTimer TRACE_CONCAT(trace_stage_, __LINE__)(stage)
+// value не вычисляется, если трассировка выключена
+#define TRACE_COUNT(counter, value) AddTraceCount(counter, value)
+
+#else
+
+#define TRACE_STAGE(stage) static_cast<void>(0)
+#define TRACE_COUNT(counter, value) static_cast<void>(0)
+
+#endif
@@ -1,6 +1,12 @@
 #include "request_queue.h"
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus document_status) {
+	if (cache_ != nullptr) {
+		const auto start = RequestStatistics::Clock::now();
+		std::vector<Document> result = cache_->FindTopDocuments(*search_server_, raw_query, document_status);
+		AddRequestResult(start, result);
+		return result;
+	}
 	return AddFindRequest(raw_query, [document_status](int, DocumentStatus status, int) {
 		return status == document_status;
 	});
@@ -10,6 +16,19 @@ std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query)
     return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
 }
 
+int RequestQueue::GetNoResultRequests() const {
+	return statistics_.GetSummary(RequestStatistics::Clock::now()).no_result_count;
+}
+
+RequestStatistics::Summary RequestQueue::GetStatistics() const {
+	return statistics_.GetSummary(RequestStatistics::Clock::now());
+}
+
+void RequestQueue::AddRequestResult(RequestStatistics::Clock::time_point start, const std::vector<Document>& result) {
+	const auto now = RequestStatistics::Clock::now();
+	statistics_.Record(now, std::chrono::duration_cast<std::chrono::microseconds>(now - start), result.size());
+}
+
 /*explicit RequestQueue::RequestQueue(const SearchServer& search_server)
 	: search_server_(&search_server)
 {
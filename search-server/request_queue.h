@@ -1,16 +1,23 @@
 #pragma once
 
 #include <vector>
-#include <deque>
 #include <string>
 #include "search_server.h"
+#include "request_statistics.h"
+#include "result_cache.h"
 
 struct Document;
 
+// Выполняет запросы и ведет их статистику за последние сутки.
+// AddFindRequest и чтение статистики можно вызывать из нескольких потоков одновременно
 class RequestQueue {
 public:
 	explicit RequestQueue(const SearchServer& search_server): search_server_(&search_server)
 {
+}
+	// Запросы по статусу идут через cache; запросы с предикатом не кэшируются
+	RequestQueue(const SearchServer& search_server, ResultCache& cache): search_server_(&search_server), cache_(&cache)
+{
 }
 
 	template <typename DocumentPredicate>
@@ -20,42 +27,21 @@ public:
 
 	std::vector<Document> AddFindRequest(const std::string& raw_query);
 
-	inline int GetNoResultRequests() const {
-		return requests_.size() - requests_.back().query_count;
-	}
-private:
-	struct QueryResult {
-		int query_count;
-	};
-
-	std::deque<QueryResult> requests_;
-	const static int min_in_day_ = 1440;
+	int GetNoResultRequests() const;
+	RequestStatistics::Summary GetStatistics() const;
 
+private:
 	const SearchServer* search_server_;
+	ResultCache* cache_ = nullptr;
+	RequestStatistics statistics_;
+
+	void AddRequestResult(RequestStatistics::Clock::time_point start, const std::vector<Document>& result);
 };
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
+    const auto start = RequestStatistics::Clock::now();
     std::vector<Document> result = search_server_->FindTopDocuments(raw_query, document_predicate);
-
-    QueryResult query_result;
-
-    if(requests_.empty()) {
-        query_result = {0};
-    } else {
-        query_result = requests_.back();
-    }
-
-    if(result.empty()) {
-        requests_.push_back(query_result);
-    } else {
-        requests_.push_back({query_result.query_count + 1});
-    }
-
-    if(requests_.size() > min_in_day_) {
-        requests_.pop_front();
-    }
-
+    AddRequestResult(start, result);
     return result;
-
 }
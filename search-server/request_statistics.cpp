@@ -0,0 +1,141 @@
+#include "request_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+using namespace std;
+
+RequestStatistics::RequestStatistics(Clock::duration bucket_duration)
+	: bucket_duration_(max(bucket_duration, Clock::duration(1)))
+	, buckets_(make_unique<Bucket[]>(BUCKET_COUNT))
+	, expired_before_(GetEpoch(Clock::now()) - static_cast<int64_t>(BUCKET_COUNT) + 1) {
+}
+
+void RequestStatistics::Record(Clock::time_point now, chrono::microseconds latency, size_t matched_document_count) {
+	const int64_t epoch = GetEpoch(now);
+	Expire(epoch);
+	Bucket& bucket = GetBucket(epoch);
+	while (true) {
+		int64_t current = bucket.epoch.load(memory_order_acquire);
+		if (current == epoch) {
+			break;
+		}
+		if (current == RESETTING) {
+			this_thread::yield();
+			continue;
+		}
+		// Запрос, записанный уже после выхода своего интервала из окна, не учитывается
+		if (current > epoch || epoch < expired_before_.load(memory_order_acquire)) {
+			return;
+		}
+		// Первый запрос нового интервала освобождает корзину от интервала на окно раньше
+		if (bucket.epoch.compare_exchange_weak(current, RESETTING, memory_order_acq_rel)) {
+			if (current != EMPTY) {
+				Retire(bucket);
+			}
+			bucket.epoch.store(epoch, memory_order_release);
+			break;
+		}
+	}
+
+	const size_t bin = GetLatencyBin(latency);
+	for (Counters* counters : {&bucket.counters, &totals_}) {
+		counters->request_count.fetch_add(1, memory_order_relaxed);
+		counters->no_result_count.fetch_add(matched_document_count == 0, memory_order_relaxed);
+		counters->matched_document_count.fetch_add(matched_document_count, memory_order_relaxed);
+		counters->latency_bins[bin].fetch_add(1, memory_order_relaxed);
+	}
+}
+
+RequestStatistics::Summary RequestStatistics::GetSummary(Clock::time_point now) const {
+	Expire(GetEpoch(now));
+	Summary summary;
+	summary.request_count = totals_.request_count.load(memory_order_relaxed);
+	summary.no_result_count = totals_.no_result_count.load(memory_order_relaxed);
+	summary.matched_document_count = totals_.matched_document_count.load(memory_order_relaxed);
+	summary.latency_p50 = GetLatencyPercentile(0.50, summary.request_count);
+	summary.latency_p95 = GetLatencyPercentile(0.95, summary.request_count);
+	summary.latency_p99 = GetLatencyPercentile(0.99, summary.request_count);
+	return summary;
+}
+
+int64_t RequestStatistics::GetEpoch(Clock::time_point time) const {
+	return time.time_since_epoch() / bucket_duration_;
+}
+
+RequestStatistics::Bucket& RequestStatistics::GetBucket(int64_t epoch) const {
+	const int64_t bucket_count = BUCKET_COUNT;
+	return buckets_[((epoch % bucket_count) + bucket_count) % bucket_count];
+}
+
+void RequestStatistics::Expire(int64_t epoch) const {
+	const int64_t first_live_epoch = epoch - static_cast<int64_t>(BUCKET_COUNT) + 1;
+	int64_t expired_before = expired_before_.load(memory_order_acquire);
+	while (expired_before < first_live_epoch) {
+		// После долгого простоя каждую корзину достаточно проверить один раз
+		const int64_t expiring = max(expired_before, first_live_epoch - static_cast<int64_t>(BUCKET_COUNT));
+		if (!expired_before_.compare_exchange_weak(expired_before, expiring + 1, memory_order_acq_rel)) {
+			continue;
+		}
+		expired_before = expiring + 1;
+		// Корзина могла хранить и более старый интервал, если в промежутке запросов не было
+		Bucket& bucket = GetBucket(expiring);
+		int64_t current = bucket.epoch.load(memory_order_acquire);
+		while (current != EMPTY && current != RESETTING && current <= expiring) {
+			if (bucket.epoch.compare_exchange_weak(current, RESETTING, memory_order_acq_rel)) {
+				Retire(bucket);
+				bucket.epoch.store(EMPTY, memory_order_release);
+				break;
+			}
+		}
+	}
+}
+
+void RequestStatistics::Retire(Bucket& bucket) const {
+	Counters& counters = bucket.counters;
+	totals_.request_count.fetch_sub(counters.request_count.exchange(0, memory_order_relaxed), memory_order_relaxed);
+	totals_.no_result_count.fetch_sub(counters.no_result_count.exchange(0, memory_order_relaxed), memory_order_relaxed);
+	totals_.matched_document_count.fetch_sub(counters.matched_document_count.exchange(0, memory_order_relaxed), memory_order_relaxed);
+	for (size_t bin = 0; bin < LATENCY_BIN_COUNT; ++bin) {
+		totals_.latency_bins[bin].fetch_sub(counters.latency_bins[bin].exchange(0, memory_order_relaxed), memory_order_relaxed);
+	}
+}
+
+// Значения до 4 мкс - отдельные корзины, дальше каждая степень двойки делится на 4 равные части
+size_t RequestStatistics::GetLatencyBin(chrono::microseconds latency) {
+	const uint64_t value = max<int64_t>(latency.count(), 0);
+	if (value < 4) {
+		return value;
+	}
+	int exponent = 63;
+	while ((value >> exponent) == 0) {
+		--exponent;
+	}
+	const size_t bin = 4 * (exponent - 1) + ((value >> (exponent - 2)) & 3);
+	return min(bin, LATENCY_BIN_COUNT - 1);
+}
+
+chrono::microseconds RequestStatistics::GetLatencyBinEnd(size_t bin) {
+	const size_t next_bin = bin + 1;
+	if (next_bin < 4) {
+		return chrono::microseconds(next_bin);
+	}
+	const int exponent = next_bin / 4 + 1;
+	return chrono::microseconds(static_cast<int64_t>(4 + next_bin % 4) << (exponent - 2));
+}
+
+chrono::microseconds RequestStatistics::GetLatencyPercentile(double percentile, uint64_t request_count) const {
+	if (request_count == 0) {
+		return chrono::microseconds(0);
+	}
+	const uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(percentile * request_count)));
+	uint64_t seen = 0;
+	for (size_t bin = 0; bin < LATENCY_BIN_COUNT; ++bin) {
+		seen += totals_.latency_bins[bin].load(memory_order_relaxed);
+		if (seen >= rank) {
+			return GetLatencyBinEnd(bin);
+		}
+	}
+	return GetLatencyBinEnd(LATENCY_BIN_COUNT - 1);
+}
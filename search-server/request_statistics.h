@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+// Статистика запросов за скользящее окно из BUCKET_COUNT корзин времени (по умолчанию сутки
+// поминутно): число запросов, запросов без результата, найденных документов и гистограмма задержек.
+// Запись и чтение не берут блокировок и не зависят от числа запросов: итоги окна хранятся
+// отдельно, а корзина, которая выпадает из окна, вычитается из них один раз.
+class RequestStatistics {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr size_t BUCKET_COUNT = 1440;
+
+	struct Summary {
+		uint64_t request_count = 0;
+		uint64_t no_result_count = 0;
+		uint64_t matched_document_count = 0;
+		// Верхние границы корзин гистограммы, в которые попал перцентиль; погрешность до 25%
+		std::chrono::microseconds latency_p50{0};
+		std::chrono::microseconds latency_p95{0};
+		std::chrono::microseconds latency_p99{0};
+	};
+
+	explicit RequestStatistics(Clock::duration bucket_duration = std::chrono::minutes(1));
+
+	// Можно вызывать из многих потоков одновременно
+	void Record(Clock::time_point now, std::chrono::microseconds latency, size_t matched_document_count);
+	// Итоги за BUCKET_COUNT корзин, последняя из которых содержит now
+	Summary GetSummary(Clock::time_point now) const;
+
+private:
+	// Задержки в микросекундах: 4 корзины на каждую степень двойки до 2^32 мкс
+	static constexpr size_t LATENCY_BIN_COUNT = 128;
+	static constexpr int64_t EMPTY = std::numeric_limits<int64_t>::min();
+	static constexpr int64_t RESETTING = EMPTY + 1;
+
+	struct Counters {
+		std::atomic<uint64_t> request_count{0};
+		std::atomic<uint64_t> no_result_count{0};
+		std::atomic<uint64_t> matched_document_count{0};
+		std::array<std::atomic<uint64_t>, LATENCY_BIN_COUNT> latency_bins{};
+	};
+
+	// Номер интервала, который сейчас хранит корзина, EMPTY или RESETTING на время очистки
+	struct alignas(64) Bucket {
+		std::atomic<int64_t> epoch{EMPTY};
+		Counters counters;
+	};
+
+	const Clock::duration bucket_duration_;
+	// Корзины и итоги меняются и при чтении: выпавшие из окна корзины вычитаются лениво
+	const std::unique_ptr<Bucket[]> buckets_;
+	mutable Counters totals_;
+	// Интервалы до этого номера уже вычтены из итогов
+	mutable std::atomic<int64_t> expired_before_;
+
+	int64_t GetEpoch(Clock::time_point time) const;
+	Bucket& GetBucket(int64_t epoch) const;
+	void Expire(int64_t epoch) const;
+	// Вычитает счетчики корзины из итогов и обнуляет их; корзина должна быть в состоянии RESETTING
+	void Retire(Bucket& bucket) const;
+
+	static size_t GetLatencyBin(std::chrono::microseconds latency);
+	static std::chrono::microseconds GetLatencyBinEnd(size_t bin);
+	std::chrono::microseconds GetLatencyPercentile(double percentile, uint64_t request_count) const;
+};
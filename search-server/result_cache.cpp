@@ -0,0 +1,159 @@
+#include "result_cache.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+using namespace std;
+
+namespace {
+
+// Слова запроса без повторов по возрастанию через пробел. Результат запроса зависит только
+// от множества его слов, поэтому такой текст годится в ключ без разбора по словарю сервера
+string NormalizeQuery(string_view raw_query) {
+	vector<string_view> words;
+	ForEachWord(raw_query, [&words](string_view word, bool) {
+		words.push_back(word);
+	});
+	sort(words.begin(), words.end());
+	words.erase(unique(words.begin(), words.end()), words.end());
+	string normalized;
+	for (const string_view word : words) {
+		if (!normalized.empty()) {
+			normalized += ' ';
+		}
+		normalized += word;
+	}
+	return normalized;
+}
+
+}  // namespace
+
+ResultCache::ResultCache(size_t capacity)
+	: segment_capacity_(max<size_t>(1, (capacity + SEGMENT_COUNT - 1) / SEGMENT_COUNT))
+	, segments_(make_unique<Segment[]>(SEGMENT_COUNT)) {
+}
+
+std::vector<Document> ResultCache::FindTopDocuments(const SearchServer& search_server, string_view raw_query,
+	const DocumentFilter& filter, size_t max_count) {
+	QueryContext context;
+	return FindTopDocuments(context, search_server, raw_query, filter, max_count);
+}
+
+std::vector<Document> ResultCache::FindTopDocuments(const SearchServer& search_server, string_view raw_query,
+	DocumentStatus status, size_t max_count) {
+	return FindTopDocuments(search_server, raw_query, DocumentFilter().SetStatuses({status}), max_count);
+}
+
+std::vector<Document> ResultCache::FindTopDocuments(const SearchServer& search_server, string_view raw_query) {
+	return FindTopDocuments(search_server, raw_query, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> ResultCache::FindTopDocuments(QueryContext& context, const SearchServer& search_server,
+	string_view raw_query, const DocumentFilter& filter, size_t max_count) {
+	Key key{search_server.GetInstanceId(), NormalizeQuery(raw_query),
+		filter.status_mask, filter.min_rating, filter.max_rating, max_count};
+	const uint64_t generation = search_server.GetGeneration();
+	Segment& segment = segments_[KeyHash()(&key) % SEGMENT_COUNT];
+	{
+		lock_guard guard(segment.mutex);
+		ObserveGeneration(segment, key.server_id, generation);
+		const auto it = segment.index.find(&key);
+		if (it != segment.index.end() && it->second->generation == generation) {
+			segment.entries.splice(segment.entries.begin(), segment.entries, it->second);
+			hit_count_.fetch_add(1, memory_order_relaxed);
+			return it->second->documents;
+		}
+	}
+	miss_count_.fetch_add(1, memory_order_relaxed);
+
+	// Запрос разбирается и выполняется без блокировки; если его одновременно посчитал
+	// другой поток, запись просто перезапишется тем же результатом
+	const PreparedQuery query = search_server.PrepareQuery(raw_query);
+	const vector<Document>& documents = search_server.FindTopDocuments(context, query, filter, max_count);
+	lock_guard guard(segment.mutex);
+	if (!ObserveGeneration(segment, key.server_id, generation)) {
+		return documents;
+	}
+	const auto it = segment.index.find(&key);
+	if (it != segment.index.end()) {
+		it->second->generation = generation;
+		it->second->documents = documents;
+		segment.entries.splice(segment.entries.begin(), segment.entries, it->second);
+		return documents;
+	}
+	if (segment.entries.size() >= segment_capacity_) {
+		EraseEntry(segment, prev(segment.entries.end()));
+	}
+	segment.entries.push_front({move(key), generation, documents});
+	segment.index.emplace(&segment.entries.front().key, segment.entries.begin());
+	++segment.servers.try_emplace(segment.entries.front().key.server_id, ServerState{generation, 0}).first->second.entry_count;
+	return documents;
+}
+
+bool ResultCache::ObserveGeneration(Segment& segment, uint64_t server_id, uint64_t generation) {
+	const auto state = segment.servers.find(server_id);
+	if (state == segment.servers.end() || state->second.generation == generation) {
+		return true;
+	}
+	if (state->second.generation > generation) {
+		return false;
+	}
+	// Поколения сервера только растут, поэтому записи прежних поколений больше не пригодятся.
+	// Вместе с последней из них из таблицы уходит и сам сервер
+	for (auto entry = segment.entries.begin(); entry != segment.entries.end();) {
+		const auto next = std::next(entry);
+		if (entry->key.server_id == server_id) {
+			EraseEntry(segment, entry);
+		}
+		entry = next;
+	}
+	return true;
+}
+
+void ResultCache::EraseEntry(Segment& segment, list<Entry>::iterator entry) {
+	const auto server = segment.servers.find(entry->key.server_id);
+	if (--server->second.entry_count == 0) {
+		segment.servers.erase(server);
+	}
+	segment.index.erase(&entry->key);
+	segment.entries.erase(entry);
+}
+
+size_t ResultCache::size() const {
+	size_t entry_count = 0;
+	for (size_t i = 0; i < SEGMENT_COUNT; ++i) {
+		lock_guard guard(segments_[i].mutex);
+		entry_count += segments_[i].entries.size();
+	}
+	return entry_count;
+}
+
+void ResultCache::Clear() {
+	for (size_t i = 0; i < SEGMENT_COUNT; ++i) {
+		lock_guard guard(segments_[i].mutex);
+		segments_[i].index.clear();
+		segments_[i].entries.clear();
+		segments_[i].servers.clear();
+	}
+}
+
+bool ResultCache::Key::operator==(const Key& other) const {
+	return server_id == other.server_id && query == other.query
+		&& status_mask == other.status_mask && min_rating == other.min_rating && max_rating == other.max_rating
+		&& max_count == other.max_count;
+}
+
+size_t ResultCache::KeyHash::operator()(const Key* key_ptr) const {
+	const Key& key = *key_ptr;
+	size_t hash = std::hash<std::string>()(key.query);
+	const auto combine = [&hash](uint64_t value) {
+		hash ^= std::hash<uint64_t>()(value) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+	};
+	combine(key.server_id);
+	combine(key.status_mask);
+	combine(static_cast<uint32_t>(key.min_rating));
+	combine(static_cast<uint32_t>(key.max_rating));
+	combine(key.max_count);
+	return hash;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Кэш результатов FindTopDocuments с вытеснением давно не использованных (LRU).
+// Ключ - номер экземпляра сервера (SearchServer::GetInstanceId), нормализованный текст запроса
+// (слова без повторов по возрастанию), фильтр и max_count. Попадание не разбирает запрос:
+// текст нормализуется одним проходом ForEachWord, PrepareQuery вызывается только при промахе.
+// Запросы, которые отличаются порядком слов или повторами, попадают в одну запись.
+// Запись помнит поколение индекса. Увидев новое поколение сервера, сегмент сразу удаляет
+// все его записи старых поколений, так что устаревшие результаты не занимают место до вытеснения.
+// Записи уничтоженных серверов (например, старых версий VersionedSearchServer) уходят по LRU.
+// Потокобезопасен: ключи распределены по сегментам со своими мьютексами.
+class ResultCache {
+public:
+	// capacity - сколько результатов хранить всего. Каждый сегмент вмещает свою долю, поэтому
+	// рабочий набор должен быть заметно меньше capacity, иначе неравномерные сегменты начнут вытеснять записи
+	explicit ResultCache(size_t capacity);
+
+	std::vector<Document> FindTopDocuments(const SearchServer& search_server, std::string_view raw_query,
+		const DocumentFilter& filter, size_t max_count = MAX_RESULT_DOCUMENT_COUNT);
+	std::vector<Document> FindTopDocuments(const SearchServer& search_server, std::string_view raw_query,
+		DocumentStatus status, size_t max_count = MAX_RESULT_DOCUMENT_COUNT);
+	std::vector<Document> FindTopDocuments(const SearchServer& search_server, std::string_view raw_query);
+	// Промах считается на буферах context
+	std::vector<Document> FindTopDocuments(QueryContext& context, const SearchServer& search_server,
+		std::string_view raw_query, const DocumentFilter& filter, size_t max_count = MAX_RESULT_DOCUMENT_COUNT);
+
+	uint64_t GetHitCount() const {
+		return hit_count_.load(std::memory_order_relaxed);
+	}
+	uint64_t GetMissCount() const {
+		return miss_count_.load(std::memory_order_relaxed);
+	}
+	size_t size() const;
+	void Clear();
+
+private:
+	static constexpr size_t SEGMENT_COUNT = 16;
+
+	struct Key {
+		uint64_t server_id;
+		std::string query;
+		uint32_t status_mask;
+		int min_rating;
+		int max_rating;
+		size_t max_count;
+
+		bool operator==(const Key& other) const;
+	};
+
+	// Индекс сегмента ссылается на ключи, которые лежат в записях списка
+	struct KeyHash {
+		size_t operator()(const Key* key) const;
+	};
+	struct KeyEqual {
+		bool operator()(const Key* lhs, const Key* rhs) const {
+			return *lhs == *rhs;
+		}
+	};
+
+	struct Entry {
+		Key key;
+		uint64_t generation;
+		std::vector<Document> documents;
+	};
+
+	// Поколение записей сервера в сегменте и их число. Сервер без записей в таблице не хранится,
+	// поэтому она не растет с числом серверов
+	struct ServerState {
+		uint64_t generation;
+		size_t entry_count;
+	};
+
+	// Начало списка - самые свежие записи
+	struct Segment {
+		mutable std::mutex mutex;
+		std::list<Entry> entries;
+		std::unordered_map<const Key*, std::list<Entry>::iterator, KeyHash, KeyEqual> index;
+		std::unordered_map<uint64_t, ServerState> servers;
+	};
+
+	// Если поколение generation сервера server_id новее его записей в сегменте, удаляет эти записи.
+	// false - поколение старше записей, и результат с ним сохранять нельзя
+	static bool ObserveGeneration(Segment& segment, uint64_t server_id, uint64_t generation);
+	static void EraseEntry(Segment& segment, std::list<Entry>::iterator entry);
+
+	size_t segment_capacity_;
+	std::unique_ptr<Segment[]> segments_;
+	std::atomic<uint64_t> hit_count_{0};
+	std::atomic<uint64_t> miss_count_{0};
+};
@@ -13,30 +13,355 @@ SearchServer::SearchServer(const string& stop_words_text)
 }
 
 void SearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const std::vector<int>& ratings) {
-	if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+	if ((document_id < 0) || (document_indexes_.count(document_id) > 0)) {
     	throw invalid_argument("Invalid document_id"s);
 	}
-	const auto[it, inserted] = documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status, document.data()});
-	const std::vector<std::string_view> words = SplitIntoWordsNoStop(it->second.text);
+	const uint32_t document_index = index_to_document_id_.size();
+	const std::vector<std::string_view> words = SplitIntoWordsNoStop(document);
+	texts_.push_back(text_arena_.Store(document));
+	index_to_document_id_.push_back(document_id);
+	ratings_.push_back(ComputeAverageRating(ratings));
+	statuses_.push_back(status);
+	removed_.resize((index_to_document_id_.size() + 63) / 64);
 
 	const double inv_word_count = 1.0 / words.size();
+	auto word_frequencies = std::make_shared<WordFrequencies>();
 	for (string_view word : words) {
-		word_to_document_freqs_[word][document_id] += inv_word_count;
-		freqs_[document_id][word] += inv_word_count;
+		const TermId term = InternTerm(word);
+		PostingList& postings = GetMutablePostings(term);
+		const size_t posting_count = postings.size();
+		postings.Add(document_index, inv_word_count);
+		document_freqs_[term] += postings.size() - posting_count;
+		(*word_frequencies)[terms_.GetTerm(term)] += inv_word_count;
 	}
+	freqs_.emplace(document_id, move(word_frequencies));
+	document_indexes_.emplace(document_id, document_index);
 	document_ids_.insert(document_id);
+	++generation_;
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
-	return SearchServer::FindTopDocuments(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-		return document_status == status;
+void SearchServer::AddDocuments(const vector<NewDocument>& documents) {
+	AddDocuments(execution::par, documents);
+}
+
+void SearchServer::AddDocuments(execution::sequenced_policy seq, const vector<NewDocument>& documents) {
+	AddDocumentsImpl(seq, documents);
+}
+
+void SearchServer::AddDocuments(execution::parallel_policy par, const vector<NewDocument>& documents) {
+	AddDocumentsImpl(par, documents);
+}
+
+void SearchServer::ValidateNewDocuments(const vector<NewDocument>& documents) const {
+	ValidateNewDocumentIds(documents);
+	for (const NewDocument& document : documents) {
+		ForEachWord(document.text, [](string_view word, bool is_valid) {
+			if (!is_valid) {
+				throw invalid_argument("Word "s + string(word) + " is invalid"s);
+			}
+		});
+	}
+}
+
+void SearchServer::ValidateNewDocumentIds(const vector<NewDocument>& documents) const {
+	set<int> batch_ids;
+	for (const NewDocument& document : documents) {
+		if (document.id < 0 || document_indexes_.count(document.id) > 0 || !batch_ids.insert(document.id).second) {
+			throw invalid_argument("Invalid document_id"s);
+		}
+	}
+}
+
+template <class ExecutionPolicy>
+void SearchServer::AddDocumentsImpl(ExecutionPolicy policy, const vector<NewDocument>& documents) {
+	ValidateNewDocumentIds(documents);
+
+	// Разбор текстов. Исключение из параллельного алгоритма завершило бы программу,
+	// поэтому ошибки собираются и пробрасываются после разбора
+	using WordFreqs = vector<pair<string_view, double>>;
+	vector<WordFreqs> document_word_freqs(documents.size());
+	vector<exception_ptr> errors(documents.size());
+	vector<size_t> positions(documents.size());
+	iota(positions.begin(), positions.end(), 0);
+	for_each(policy, positions.begin(), positions.end(), [&](size_t i) {
+		try {
+			vector<string_view> words = SplitIntoWordsNoStop(documents[i].text);
+			const double inv_word_count = 1.0 / words.size();
+			sort(words.begin(), words.end());
+			WordFreqs& word_freqs = document_word_freqs[i];
+			for (const string_view word : words) {
+				if (word_freqs.empty() || word_freqs.back().first != word) {
+					word_freqs.push_back({word, 0.0});
+				}
+				word_freqs.back().second += inv_word_count;
+			}
+		} catch (...) {
+			errors[i] = current_exception();
+		}
+	});
+	for (const exception_ptr& error : errors) {
+		if (error) {
+			rethrow_exception(error);
+		}
+	}
+
+	// Инверсия сортировкой: все пары пакета упорядочиваются по (терм, документ),
+	// после чего вхождения каждого терма идут подряд и дописываются в конец его списка
+	struct PostingEntry {
+		TermId term;
+		uint32_t document_index;
+		double term_freq;
+	};
+	const uint32_t first_index = index_to_document_id_.size();
+	vector<PostingEntry> entries;
+	for (size_t i = 0; i < documents.size(); ++i) {
+		for (const auto& [word, term_freq] : document_word_freqs[i]) {
+			entries.push_back({InternTerm(word), first_index + static_cast<uint32_t>(i), term_freq});
+		}
+	}
+	// Порядок записей одного документа до сортировки совпадает с document_word_freqs
+	vector<TermId> entry_terms(entries.size());
+	transform(entries.begin(), entries.end(), entry_terms.begin(), [](const PostingEntry& entry) {
+		return entry.term;
+	});
+	sort(policy, entries.begin(), entries.end(), [](const PostingEntry& lhs, const PostingEntry& rhs) {
+		return tie(lhs.term, lhs.document_index) < tie(rhs.term, rhs.document_index);
 	});
+	vector<size_t> run_begins;
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (i == 0 || entries[i].term != entries[i - 1].term) {
+			run_begins.push_back(i);
+		}
+	}
+	for_each(policy, run_begins.begin(), run_begins.end(), [&](size_t run_begin) {
+		PostingList& postings = GetMutablePostings(entries[run_begin].term);
+		size_t run_end = run_begin;
+		while (run_end < entries.size() && entries[run_end].term == entries[run_begin].term) {
+			++run_end;
+		}
+		postings.Reserve(postings.size() + (run_end - run_begin));
+		for (size_t i = run_begin; i < run_end; ++i) {
+			postings.Add(entries[i].document_index, entries[i].term_freq);
+		}
+		document_freqs_[entries[run_begin].term] += run_end - run_begin;
+	});
+
+	auto entry_term = entry_terms.begin();
+	for (size_t i = 0; i < documents.size(); ++i) {
+		const NewDocument& document = documents[i];
+		texts_.push_back(text_arena_.Store(document.text));
+		index_to_document_id_.push_back(document.id);
+		ratings_.push_back(ComputeAverageRating(document.ratings));
+		statuses_.push_back(document.status);
+		auto word_frequencies = std::make_shared<WordFrequencies>();
+		for (const auto& [word, term_freq] : document_word_freqs[i]) {
+			word_frequencies->emplace_hint(word_frequencies->end(), terms_.GetTerm(*entry_term++), term_freq);
+		}
+		freqs_.emplace(document.id, move(word_frequencies));
+		document_indexes_.emplace(document.id, first_index + i);
+		document_ids_.insert(document.id);
+	}
+	removed_.resize((index_to_document_id_.size() + 63) / 64);
+	++generation_;
+}
+
+void SearchServer::SetRankingMode(RankingMode mode) {
+	ranking_mode_ = mode;
+}
+
+void SearchServer::SetPostingFormat(PostingFormat format) {
+	posting_format_ = format;
+	for_each(execution::par, word_to_document_freqs_.begin(), word_to_document_freqs_.end(), [format](shared_ptr<PostingList>& postings) {
+		if (postings->IsCompressed() != (format == PostingFormat::COMPRESSED)) {
+			Unshare(postings).SetCompressed(format == PostingFormat::COMPRESSED);
+		}
+	});
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(string_view raw_query, const DocumentFilter& filter, size_t max_count) const {
+	ThreadQueryContext context;
+	return FindTopDocuments(context.Get(), raw_query, filter, max_count);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status, size_t max_count) const {
+	return FindTopDocuments(raw_query, DocumentFilter().SetStatuses({status}), max_count);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(string_view raw_query) const {
 	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryContext& context, string_view raw_query,
+	const DocumentFilter& filter, size_t max_count) const {
+	ParseQuery(raw_query, context);
+	RankFiltered(context.query_, filter, context.filter_bitmap_, [&](auto index_predicate) {
+		RankDocuments(context, index_predicate, max_count);
+	});
+	return context.result_;
+}
+
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryContext& context, string_view raw_query,
+	DocumentStatus status, size_t max_count) const {
+	return FindTopDocuments(context, raw_query, DocumentFilter().SetStatuses({status}), max_count);
+}
+
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryContext& context, string_view raw_query) const {
+	return FindTopDocuments(context, raw_query, DocumentStatus::ACTUAL);
+}
+
+PreparedQuery SearchServer::PrepareQuery(string_view raw_query) const {
+	PreparedQuery prepared;
+	prepared.text_ = string(raw_query);
+	prepared.server_id_ = instance_id_.Get();
+	prepared.generation_ = generation_;
+	vector<string_view> words;
+	ParseQuery(prepared.text_, true, words, prepared.query_);
+	prepared.inverse_document_freqs_.resize(prepared.query_.plus_terms.size());
+	transform(prepared.query_.plus_terms.begin(), prepared.query_.plus_terms.end(), prepared.inverse_document_freqs_.begin(),
+		[this](TermId term) {
+			return ComputeWordInverseDocumentFreq(term);
+		});
+	return prepared;
+}
+
+PreparedQuery SearchServer::PrepareQuery(string_view raw_query,
+	const function<double(string_view)>& inverse_document_freq) const {
+	PreparedQuery prepared = PrepareQuery(raw_query);
+	prepared.has_external_inverse_document_freqs_ = true;
+	transform(prepared.query_.plus_terms.begin(), prepared.query_.plus_terms.end(), prepared.inverse_document_freqs_.begin(),
+		[&](TermId term) {
+			return inverse_document_freq(terms_.GetTerm(term));
+		});
+	return prepared;
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, const DocumentFilter& filter, size_t max_count) const {
+	ThreadQueryContext context;
+	return FindTopDocuments(context.Get(), query, filter, max_count);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentStatus status, size_t max_count) const {
+	return FindTopDocuments(query, DocumentFilter().SetStatuses({status}), max_count);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query) const {
+	return FindTopDocuments(query, DocumentStatus::ACTUAL);
+}
+
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryContext& context, const PreparedQuery& query,
+	const DocumentFilter& filter, size_t max_count) const {
+	LoadPreparedQuery(query, context);
+	RankFiltered(context.query_, filter, context.filter_bitmap_, [&](auto index_predicate) {
+		RankDocuments(context, index_predicate, max_count);
+	});
+	return context.result_;
+}
+
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryContext& context, const PreparedQuery& query,
+	DocumentStatus status, size_t max_count) const {
+	return FindTopDocuments(context, query, DocumentFilter().SetStatuses({status}), max_count);
+}
+
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryContext& context, const PreparedQuery& query) const {
+	return FindTopDocuments(context, query, DocumentStatus::ACTUAL);
+}
+
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const std::vector<BatchQuery>& queries) const {
+	const size_t query_count = queries.size();
+	// Вхождение слова в запрос пакета. Слова упорядочены по тексту, как и плюс-слова внутри
+	// каждого запроса, поэтому релевантность документа складывается в том же порядке,
+	// что и при отдельном запросе, и совпадает до бита
+	struct TermUse {
+		string_view word;
+		TermId term;
+		uint32_t query;
+		double inverse_document_freq;
+	};
+	vector<TermUse> term_uses;
+	vector<DocumentBitmap> excluded_documents(query_count);
+	vector<TopDocuments> top_documents;
+	top_documents.reserve(query_count);
+	QueryContext context;
+	for (size_t k = 0; k < query_count; ++k) {
+		LoadPreparedQuery(*queries[k].query, context);
+		for (size_t i = 0; i < context.query_.plus_terms.size(); ++i) {
+			const TermId term = context.query_.plus_terms[i];
+			term_uses.push_back({terms_.GetTerm(term), term, static_cast<uint32_t>(k), context.inverse_document_freqs_[i]});
+		}
+		if (!context.query_.minus_terms.empty()) {
+			excluded_documents[k] = BuildExcludedDocuments(context.query_);
+		}
+		top_documents.emplace_back(queries[k].max_count);
+	}
+	sort(term_uses.begin(), term_uses.end(), [](const TermUse& lhs, const TermUse& rhs) {
+		return tie(lhs.word, lhs.query) < tie(rhs.word, rhs.query);
+	});
+
+	// Курсор на каждое различное слово пакета и отрезок term_uses с его запросами
+	struct TermGroup {
+		PostingList::const_iterator it;
+		PostingList::const_iterator end;
+		size_t first_use;
+		size_t last_use;
+	};
+	vector<TermGroup> groups;
+	for (size_t i = 0; i < term_uses.size();) {
+		size_t j = i;
+		while (j < term_uses.size() && term_uses[j].term == term_uses[i].term) {
+			++j;
+		}
+		const PostingList& postings = GetPostings(term_uses[i].term);
+		groups.push_back({postings.begin(), postings.end(), i, j});
+		i = j;
+	}
+
+	// Релевантность считается по окнам внутренних индексов в плотный массив [документ окна][запрос]:
+	// запросы одного вхождения лежат рядом. Окно подбирается так, чтобы массив помещался в кэш
+	const uint32_t window_size = clamp<uint32_t>(BATCH_WINDOW_BYTES / (max<size_t>(query_count, 1) * sizeof(double)),
+		MIN_BATCH_WINDOW_SIZE, MAX_SCORE_WINDOW_SIZE);
+	const uint32_t document_count = index_to_document_id_.size();
+	vector<double> relevance(query_count * window_size);
+	vector<char> is_matched(query_count * window_size);
+	vector<vector<uint32_t>> matched_offsets(query_count);
+	for (uint32_t window_begin = 0; window_begin < document_count && !groups.empty(); window_begin += window_size) {
+		const uint32_t window_end = min<uint64_t>(document_count, uint64_t{window_begin} + window_size);
+		for (TermGroup& group : groups) {
+			for (; group.it != group.end && group.it->document_index < window_end; ++group.it) {
+				const uint32_t offset = group.it->document_index - window_begin;
+				const double term_freq = group.it->term_freq;
+				for (size_t i = group.first_use; i < group.last_use; ++i) {
+					const size_t slot = offset * query_count + term_uses[i].query;
+					if (!is_matched[slot]) {
+						is_matched[slot] = true;
+						matched_offsets[term_uses[i].query].push_back(offset);
+					}
+					relevance[slot] += term_freq * term_uses[i].inverse_document_freq;
+				}
+			}
+		}
+
+		for (size_t k = 0; k < query_count; ++k) {
+			for (const uint32_t offset : matched_offsets[k]) {
+				const size_t slot = offset * query_count + k;
+				const uint32_t document_index = window_begin + offset;
+				if (!IsRemoved(document_index) && !excluded_documents[k].Contains(document_index)
+					&& queries[k].filter.Matches(statuses_[document_index], ratings_[document_index])) {
+					top_documents[k].Add(MakeDocument(document_index, relevance[slot]));
+				}
+				relevance[slot] = 0.0;
+				is_matched[slot] = false;
+			}
+			matched_offsets[k].clear();
+		}
+	}
+
+	vector<vector<Document>> result(query_count);
+	for (size_t k = 0; k < query_count; ++k) {
+		result[k] = top_documents[k].Extract();
+	}
+	return result;
+}
+
 std::set<int>::const_iterator SearchServer::begin() const {
 	return document_ids_.begin();
 }
@@ -46,14 +371,28 @@ std::set<int>::const_iterator SearchServer::end() const {
 }
 
 int SearchServer::GetDocumentCount() const {
-	return documents_.size();
+	return document_ids_.size();
+}
+
+uint64_t SearchServer::GetGeneration() const {
+	return generation_;
+}
+
+uint64_t SearchServer::GetInstanceId() const {
+	return instance_id_.Get();
+}
+
+int SearchServer::GetDocumentFrequency(string_view word) const {
+	const TermId term = terms_.Find(word);
+	return term == TermDictionary::NO_TERM ? 0 : static_cast<int>(document_freqs_[term]);
 }
 
 //не до конца понял что нужно делать со статической константой, да и в целом задачу по данному методу. Сделал как понял :-). Наверняка ее еще нужно вынести из класса :-)
 const std::map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
 	static const map<string_view, double> empty_map= {};
-	if (freqs_.count(document_id) != 0) {
-		return freqs_.at(document_id);
+	const auto it = freqs_.find(document_id);
+	if (it != freqs_.end()) {
+		return it->second != nullptr ? *it->second : GetSnapshotWordFrequencies(document_id);
 	}
 	return empty_map;
 }
@@ -65,71 +404,304 @@ void SearchServer::RemoveDocument(int document_id) {
 using MatchedDocuments = std::tuple<std::vector<std::string_view>, DocumentStatus>;
 
 MatchedDocuments SearchServer::MatchDocument(string_view raw_query, int document_id) const {
-	if (documents_.count(document_id) == 0) {
-		throw std::out_of_range("");
-	}
-	const auto query = ParseQuery(raw_query, true);
-	vector<string_view> matched_words(query.plus_words.size());
+	ThreadQueryContext context;
+	const auto [matched_words, status] = MatchDocument(context.Get(), raw_query, document_id);
+	return {matched_words, status};
+}
+
+std::tuple<const std::vector<std::string_view>&, DocumentStatus> SearchServer::MatchDocument(
+	QueryContext& context, string_view raw_query, int document_id) const {
+	const uint32_t document_index = document_indexes_.at(document_id);
+	ParseQuery(raw_query, true, context.words_, context.query_);
+	return MatchQuery(context, document_index);
+}
+
+MatchedDocuments SearchServer::MatchDocument(const PreparedQuery& query, int document_id) const {
+	ThreadQueryContext context;
+	const auto [matched_words, status] = MatchDocument(context.Get(), query, document_id);
+	return {matched_words, status};
+}
+
+std::tuple<const std::vector<std::string_view>&, DocumentStatus> SearchServer::MatchDocument(
+	QueryContext& context, const PreparedQuery& query, int document_id) const {
+	const uint32_t document_index = document_indexes_.at(document_id);
+	LoadPreparedQuery(query, context);
+	return MatchQuery(context, document_index);
+}
+
+std::tuple<const std::vector<std::string_view>&, DocumentStatus> SearchServer::MatchQuery(
+	QueryContext& context, uint32_t document_index) const {
+	TRACE_STAGE(TraceStage::MATCH_DOCUMENT);
+	const Query& query = context.query_;
+	vector<string_view>& matched_words = context.matched_words_;
+	matched_words.clear();
 	
-	auto checker = [&] (const string_view word) {return freqs_.at(document_id).count(word);};
-	if (std::any_of(query.minus_words.begin(), query.minus_words.end(),checker)) {
-		return { {}, documents_.at(document_id).status};
+	auto checker = [&] (const TermId term) {return ContainsTerm(term, document_index);};
+	if (std::any_of(query.minus_terms.begin(), query.minus_terms.end(),checker)) {
+		return {matched_words, statuses_[document_index]};
 	}
 	
-	auto iter_end = std::copy_if(query.plus_words.begin(), query.plus_words.end(), matched_words.begin(), checker);
-	matched_words.resize(distance(matched_words.begin(), iter_end));
+	for (const TermId term : query.plus_terms) {
+		if (checker(term)) {
+			matched_words.push_back(terms_.GetTerm(term));
+		}
+	}
   
-	return {matched_words, documents_.at(document_id).status};
+	return {matched_words, statuses_[document_index]};
 }
 
 MatchedDocuments SearchServer::MatchDocument(
-	std::execution::sequenced_policy seq, const std::string_view raw_query, int document_id) const {
+	std::execution::sequenced_policy, const std::string_view raw_query, int document_id) const {
 		return MatchDocument(raw_query, document_id);
 	}
 
 MatchedDocuments SearchServer::MatchDocument(std::execution::parallel_policy par, const std::string_view raw_query, int document_id) const {
-	if (documents_.count(document_id) == 0) {
-		throw std::out_of_range("");
-	}
+	const uint32_t document_index = document_indexes_.at(document_id);
 	const auto query = ParseQuery(raw_query, false);
-	vector<string_view> matched_words(query.plus_words.size());
+	vector<TermId> matched_terms(query.plus_terms.size());
 	
-	auto checker = [&] (const string_view word) {return freqs_.at(document_id).count(word);};
-	if (std::any_of(query.minus_words.begin(), query.minus_words.end(),checker)) {
-		return { {}, documents_.at(document_id).status};
+	auto checker = [&] (const TermId term) {return ContainsTerm(term, document_index);};
+	if (std::any_of(par, query.minus_terms.begin(), query.minus_terms.end(),checker)) {
+		return {vector<string_view>{}, statuses_[document_index]};
 	}
 	
-	auto iter_end = std::copy_if(query.plus_words.begin(), query.plus_words.end(), matched_words.begin(), checker);
-	matched_words.resize(distance(matched_words.begin(), iter_end));
+	auto iter_end = std::copy_if(par, query.plus_terms.begin(), query.plus_terms.end(), matched_terms.begin(), checker);
+	vector<string_view> matched_words(distance(matched_terms.begin(), iter_end));
+	std::transform(matched_terms.begin(), iter_end, matched_words.begin(), [this](const TermId term) {
+		return terms_.GetTerm(term);
+	});
 	
 	sort(execution::par, matched_words.begin(), matched_words.end());
 	auto last = unique(matched_words.begin(), matched_words.end());
 	matched_words.resize(distance(matched_words.begin(), last));
 	
-	return {matched_words, documents_.at(document_id).status};
+	return {matched_words, statuses_[document_index]};
+}
+
+std::vector<MatchedDocuments> SearchServer::MatchDocuments(string_view raw_query, const vector<int>& document_ids) const {
+	return MatchDocuments(execution::seq, raw_query, document_ids);
+}
+
+std::vector<MatchedDocuments> SearchServer::MatchDocuments(execution::sequenced_policy seq, string_view raw_query,
+	const vector<int>& document_ids) const {
+	return MatchDocumentsImpl(seq, raw_query, document_ids);
+}
+
+std::vector<MatchedDocuments> SearchServer::MatchDocuments(execution::parallel_policy par, string_view raw_query,
+	const vector<int>& document_ids) const {
+	return MatchDocumentsImpl(par, raw_query, document_ids);
+}
+
+template <class ExecutionPolicy>
+std::vector<MatchedDocuments> SearchServer::MatchDocumentsImpl(ExecutionPolicy policy, string_view raw_query,
+	const vector<int>& document_ids) const {
+	TRACE_STAGE(TraceStage::MATCH_DOCUMENT);
+	vector<uint32_t> document_indexes(document_ids.size());
+	transform(document_ids.begin(), document_ids.end(), document_indexes.begin(), [this](int document_id) {
+		return document_indexes_.at(document_id);
+	});
+	const Query query = ParseQuery(raw_query, true);
+
+	// Позиции document_ids в порядке возрастания внутренних индексов, как в списках вхождений
+	const size_t document_count = document_ids.size();
+	vector<size_t> order(document_count);
+	iota(order.begin(), order.end(), 0);
+	sort(order.begin(), order.end(), [&document_indexes](size_t lhs, size_t rhs) {
+		return document_indexes[lhs] < document_indexes[rhs];
+	});
+
+	// Параллельно обрабатываются отрезки отсортированных документов: каждый отрезок
+	// сливается со всеми списками вхождений и пишет только в свои результаты
+	size_t chunk_size = max<size_t>(document_count, 1);
+	if constexpr (is_same_v<ExecutionPolicy, execution::parallel_policy>) {
+		const size_t max_chunk_count = max(1u, thread::hardware_concurrency()) * 4;
+		chunk_size = max(MIN_PARALLEL_MATCH_CHUNK_SIZE, (document_count + max_chunk_count - 1) / max_chunk_count);
+	}
+	vector<size_t> chunk_begins;
+	for (size_t chunk_begin = 0; chunk_begin < document_count; chunk_begin += chunk_size) {
+		chunk_begins.push_back(chunk_begin);
+	}
+
+	vector<MatchedDocuments> result(document_count);
+	vector<char> is_excluded(document_count);
+	for_each(policy, chunk_begins.begin(), chunk_begins.end(), [&](size_t chunk_begin) {
+		const size_t chunk_end = min(document_count, chunk_begin + chunk_size);
+		auto for_each_match = [&](TermId term, auto action) {
+			const PostingList& postings = GetPostings(term);
+			auto it = postings.LowerBound(document_indexes[order[chunk_begin]]);
+			for (size_t i = chunk_begin; i < chunk_end && it != postings.end(); ++i) {
+				const uint32_t document_index = document_indexes[order[i]];
+				postings.SkipTo(it, document_index);
+				if (it != postings.end() && it->document_index == document_index) {
+					action(order[i]);
+				}
+			}
+		};
+
+		for (const TermId term : query.minus_terms) {
+			for_each_match(term, [&is_excluded](size_t pos) {
+				is_excluded[pos] = true;
+			});
+		}
+		for (const TermId term : query.plus_terms) {
+			for_each_match(term, [&](size_t pos) {
+				if (!is_excluded[pos]) {
+					get<0>(result[pos]).push_back(terms_.GetTerm(term));
+				}
+			});
+		}
+		for (size_t i = chunk_begin; i < chunk_end; ++i) {
+			get<1>(result[order[i]]) = statuses_[document_indexes[order[i]]];
+		}
+	});
+	return result;
 }
 
 bool SearchServer::IsStopWord(string_view word) const {
 	return stop_words_.count(word) > 0;
 }
 
+void SearchServer::ReleaseDocumentText(uint32_t document_index) {
+	text_arena_.Release(texts_[document_index]);
+	texts_[document_index] = {};
+	// Уплотнение копирует живые тексты в новую арену, когда мусор в блоках превысил
+	// объем живых данных; так каждый байт переносится в среднем не больше одного раза
+	if (text_arena_.GetFreeBytes() < max(MIN_TEXT_COMPACTION_BYTES, text_arena_.GetLiveBytes())) {
+		return;
+	}
+	DocumentTextArena compacted;
+	for (const auto [document_id, index] : document_indexes_) {
+		texts_[index] = compacted.Store(texts_[index]);
+	}
+	text_arena_ = move(compacted);
+}
+
+void SearchServer::CompactDocuments(execution::sequenced_policy seq) {
+	CompactDocumentsImpl(seq);
+}
+
+void SearchServer::CompactDocuments(execution::parallel_policy par) {
+	CompactDocumentsImpl(par);
+}
+
+// Живые документы сохраняют взаимный порядок, поэтому переписанные списки остаются отсортированными
+template <class ExecutionPolicy>
+void SearchServer::CompactDocumentsImpl(ExecutionPolicy policy) {
+	const uint32_t document_count = index_to_document_id_.size();
+	vector<uint32_t> new_indexes(document_count);
+	uint32_t live_count = 0;
+	for (uint32_t document_index = 0; document_index < document_count; ++document_index) {
+		if (IsRemoved(document_index)) {
+			continue;
+		}
+		new_indexes[document_index] = live_count;
+		index_to_document_id_[live_count] = index_to_document_id_[document_index];
+		ratings_[live_count] = ratings_[document_index];
+		statuses_[live_count] = statuses_[document_index];
+		texts_[live_count] = texts_[document_index];
+		++live_count;
+	}
+	index_to_document_id_.resize(live_count);
+	ratings_.resize(live_count);
+	statuses_.resize(live_count);
+	texts_.resize(live_count);
+	for (auto& [document_id, document_index] : document_indexes_) {
+		document_index = new_indexes[document_index];
+	}
+
+	vector<TermId> terms(word_to_document_freqs_.size());
+	iota(terms.begin(), terms.end(), 0);
+	for_each(policy, terms.begin(), terms.end(), [&](TermId term) {
+		const PostingList& postings = GetPostings(term);
+		if (postings.empty()) {
+			return;
+		}
+		auto compacted = std::make_shared<PostingList>();
+		compacted->SetCompressed(postings.IsCompressed());
+		compacted->Reserve(document_freqs_[term]);
+		for (const auto [document_index, term_freq] : postings) {
+			if (!IsRemoved(document_index)) {
+				compacted->Add(new_indexes[document_index], term_freq);
+			}
+		}
+		// Новый список еще никто не видит, поэтому копия сервера сохраняет старый
+		word_to_document_freqs_[term] = move(compacted);
+	});
+	removed_.assign((live_count + 63) / 64, 0);
+	removed_count_ = 0;
+}
+
+TermId SearchServer::InternTerm(string_view word) {
+	const TermId term = terms_.Intern(word);
+	if (term == word_to_document_freqs_.size()) {
+		word_to_document_freqs_.push_back(std::make_shared<PostingList>());
+		word_to_document_freqs_.back()->SetCompressed(posting_format_ == PostingFormat::COMPRESSED);
+		inverse_document_freqs_.emplace_back();
+		document_freqs_.push_back(0);
+	}
+	return term;
+}
+
+DocumentBitmap SearchServer::BuildExcludedDocuments(const Query& query) const {
+	TRACE_STAGE(TraceStage::MINUS_WORDS);
+	std::vector<uint32_t> document_indexes;
+	for (const TermId term : query.minus_terms) {
+		for (const auto [document_index, _] : GetPostings(term)) {
+			document_indexes.push_back(document_index);
+		}
+	}
+	return DocumentBitmap(std::move(document_indexes));
+}
+
+void SearchServer::MarkExcludedDocuments(QueryContext& context, bool is_excluded) const {
+	TRACE_STAGE(TraceStage::MINUS_WORDS);
+	std::vector<uint64_t>& excluded = context.excluded_;
+	excluded.resize((index_to_document_id_.size() + 63) / 64);
+	for (const TermId term : context.query_.minus_terms) {
+		for (const auto [document_index, _] : GetPostings(term)) {
+			if (is_excluded) {
+				excluded[document_index / 64] |= uint64_t{1} << (document_index % 64);
+			} else {
+				excluded[document_index / 64] = 0;
+			}
+		}
+	}
+}
+
+// Проход по столбцам без ветвлений: компилятор может векторизовать его
+void SearchServer::BuildFilterBitmap(const DocumentFilter& filter, std::vector<uint64_t>& bitmap) const {
+	TRACE_STAGE(TraceStage::FILTER);
+	const size_t document_count = index_to_document_id_.size();
+	bitmap.assign((document_count + 63) / 64, 0);
+	for (size_t i = 0; i < document_count; ++i) {
+		const uint64_t is_passed = ((filter.status_mask >> static_cast<uint32_t>(statuses_[i])) & 1)
+			& (ratings_[i] >= filter.min_rating)
+			& (ratings_[i] <= filter.max_rating);
+		bitmap[i / 64] |= is_passed << (i % 64);
+	}
+}
+
+bool SearchServer::ContainsTerm(TermId term, uint32_t document_index) const {
+	const PostingList& postings = GetPostings(term);
+	const auto it = postings.LowerBound(document_index);
+	return it != postings.end() && it->document_index == document_index;
+}
+
 std::vector<string_view> SearchServer::SplitIntoWordsNoStop(string_view text) const {
 	std::vector<string_view> words;
-	for (const string_view word : SplitIntoWords(text)) {
-		if (!IsValidWord(string(word))) {
+	ForEachWord(text, [&](string_view word, bool is_valid) {
+		if (!is_valid) {
 			throw invalid_argument("Word "s + string(word) + " is invalid"s);
 		}
 		if (!IsStopWord(word)) {
 			words.push_back(word);
 		}
-	}
+	});
 	return words;
 }
 
-bool SearchServer::IsValidWord(const string word) {
-	return none_of(word.begin(), word.end(), [](char c) {
-		return c >= '\0' && c < ' ';
-	});
+bool SearchServer::IsValidWord(string_view word) {
+	return none_of(word.begin(), word.end(), IsInvalidWordChar);
 }
 
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
@@ -140,17 +712,15 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
 	return rating_sum / static_cast<int>(ratings.size());
 }
 
+// ForEachWord не выдает пустых слов, поэтому text не пуст
 SearchServer::QueryWord SearchServer::ParseQueryWord(string_view text) const {
-	if (text.empty()) {
-		throw invalid_argument("Query word is empty"s);
-	}
 	bool is_minus = false;
 	auto word = text;
 	if (word[0] == '-') {
 		is_minus = true;
 		word = word.substr(1);
 	}
-	if (word.empty() || word[0] == '-' || !IsValidWord(string(word))) {
+	if (word.empty() || word[0] == '-') {
 		throw invalid_argument("Query word "s + string(word) + " is invalid");
 	}
 
@@ -159,26 +729,70 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(string_view text) const {
 
 SearchServer::Query SearchServer::ParseQuery(string_view text, bool sorted) const {
 	Query result;
-	vector<string_view> words = SplitIntoWords(text);
-    
+	vector<string_view> words;
+	ParseQuery(text, sorted, words, result);
+	return result;
+}
+
+void SearchServer::ParseQuery(string_view text, QueryContext& context) const {
+	ParseQuery(text, true, context.words_, context.query_);
+	context.inverse_document_freqs_.resize(context.query_.plus_terms.size());
+	transform(context.query_.plus_terms.begin(), context.query_.plus_terms.end(), context.inverse_document_freqs_.begin(),
+		[this](TermId term) {
+			return ComputeWordInverseDocumentFreq(term);
+		});
+}
+
+void SearchServer::LoadPreparedQuery(const PreparedQuery& query, QueryContext& context) const {
+	if (query.server_id_ != instance_id_.Get() || query.generation_ != generation_) {
+		// Функции IDF вызывающего у запроса нет, а местные IDF дали бы другие веса
+		if (query.has_external_inverse_document_freqs_) {
+			throw runtime_error("Prepared query with external IDF is out of date"s);
+		}
+		ParseQuery(query.text_, context);
+		return;
+	}
+	context.query_.plus_terms.assign(query.query_.plus_terms.begin(), query.query_.plus_terms.end());
+	context.query_.minus_terms.assign(query.query_.minus_terms.begin(), query.query_.minus_terms.end());
+	context.inverse_document_freqs_.assign(query.inverse_document_freqs_.begin(), query.inverse_document_freqs_.end());
+}
+
+void SearchServer::ParseQuery(string_view text, bool sorted, vector<string_view>& words, Query& result) const {
+	TRACE_STAGE(TraceStage::PARSE_QUERY);
+	words.clear();
+	result.plus_terms.clear();
+	result.minus_terms.clear();
+	// Управляющие символы ForEachWord находит при разборе, повторно слово не просматривается
+	ForEachWord(text, [&words](string_view word, bool is_valid) {
+		if (!is_valid) {
+			throw invalid_argument("Query word "s + string(word) + " is invalid"s);
+		}
+		words.push_back(word);
+	});
+
+	// Слов в запросе немного: параллельная сортировка обошлась бы дороже самой сортировки
 	if(sorted) {
-		sort(execution::par, words.begin(), words.end());
+		sort(words.begin(), words.end());
 		auto last = unique(words.begin(), words.end());
 		words.resize(distance(words.begin(), last));
 	}
     
 	for_each(words.begin(), words.end(), [&](auto& word) {
 		const auto query_word = ParseQueryWord(word);
-		if (!query_word.is_stop) {
-			if (query_word.is_minus) {
-				result.minus_words.push_back(query_word.data);
-			} else {
-				result.plus_words.push_back(query_word.data);
-			}
+		if (query_word.is_stop) {
+			return;
+		}
+		// Слова, которых нет в индексе, ни с одним документом не совпадут
+		const TermId term = terms_.Find(query_word.data);
+		if (term == TermDictionary::NO_TERM) {
+			return;
+		}
+		if (query_word.is_minus) {
+			result.minus_terms.push_back(term);
+		} else {
+			result.plus_terms.push_back(term);
 		}
 	});
-    
-	return result;
 }
 
 
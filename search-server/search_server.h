@@ -1,14 +1,24 @@
 #pragma once
 
 #include "document.h"
+#include "document_bitmap.h"
+#include "document_filter.h"
+#include "document_text_arena.h"
 #include "read_input_functions.h"
 #include "string_processing.h"
-#include "concurrent_map.h"
+#include "posting_list.h"
+#include "prepared_query.h"
+#include "query_context.h"
+#include "query_trace.h"
+#include "term_dictionary.h"
+#include "thread_pool.h"
+#include "top_documents.h"
 
 #include <vector>
 #include <set>
 #include <string>
 #include <map>
+#include <deque>
 #include <algorithm>
 #include <cmath>
 #include <numeric>
@@ -16,9 +26,38 @@
 #include <functional>
 #include <unordered_set>
 #include <atomic>
+#include <thread>
+#include <limits>
+#include <memory>
+
+// Документ для пакетного добавления; text должен быть жив до конца вызова AddDocuments
+struct NewDocument {
+	int id;
+	std::string_view text;
+	DocumentStatus status;
+	std::vector<int> ratings;
+};
+
+// Запрос пакета для FindTopDocumentsBatch; query должен быть жив до конца вызова
+struct BatchQuery {
+	const PreparedQuery* query;
+	DocumentFilter filter;
+	size_t max_count;
+};
+
+// EXHAUSTIVE - считаем релевантность всех документов, MAX_SCORE - пропускаем документы,
+// которые по верхней оценке не попадут в топ. Результаты режимов совпадают.
+enum class RankingMode {
+	EXHAUSTIVE,
+	MAX_SCORE,
+};
 
-const int MAX_RESULT_DOCUMENT_COUNT = 5;
-const double EPSILON = 1e-6;
+// PLAIN - индексы документов в списках вхождений хранятся как есть, COMPRESSED - упакованы
+// блоками разностей: меньше памяти ценой распаковки блока при обходе. Результаты не меняются.
+enum class PostingFormat {
+	PLAIN,
+	COMPRESSED,
+};
 
 class SearchServer {
 public:
@@ -45,15 +84,83 @@ public:
 
 	void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
+	// Пакетное добавление: тексты разбираются параллельно, списки вхождений строятся сортировкой
+	// всех пар (слово, документ) пакета и дописываются в индекс за один проход.
+	// Если хоть один документ некорректен, индекс не меняется.
+	void AddDocuments(const std::vector<NewDocument>& documents);
+	void AddDocuments(std::execution::sequenced_policy seq, const std::vector<NewDocument>& documents);
+	void AddDocuments(std::execution::parallel_policy par, const std::vector<NewDocument>& documents);
+	// Проверяет пакет так же, как AddDocuments, не меняя индекс: бросает invalid_argument
+	// при отрицательном, повторном или уже занятом id и при недопустимом символе в тексте
+	void ValidateNewDocuments(const std::vector<NewDocument>& documents) const;
+
+	// Действует на последовательный FindTopDocuments без политики выполнения
+	void SetRankingMode(RankingMode mode);
+	// Перекодирует уже построенный индекс и задает формат для новых слов
+	void SetPostingFormat(PostingFormat format);
+
+	// max_count - сколько лучших документов вернуть
 	template <typename DocumentPredicate>
-	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
-	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const ;
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+		size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, const DocumentFilter& filter,
+		size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+		size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
 	std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+	// Те же запросы на буферах context. Результат хранится в context
+	// и действителен до следующего запроса с этим контекстом
+	template <typename DocumentPredicate>
+	const std::vector<Document>& FindTopDocuments(QueryContext& context, std::string_view raw_query,
+		DocumentPredicate document_predicate, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	const std::vector<Document>& FindTopDocuments(QueryContext& context, std::string_view raw_query,
+		const DocumentFilter& filter, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	const std::vector<Document>& FindTopDocuments(QueryContext& context, std::string_view raw_query,
+		DocumentStatus status, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	const std::vector<Document>& FindTopDocuments(QueryContext& context, std::string_view raw_query) const;
+
+	// Разбирает запрос один раз для повторных вызовов. Ошибки запроса - как у FindTopDocuments
+	PreparedQuery PrepareQuery(std::string_view raw_query) const;
+	// То же с IDF плюс-слов от inverse_document_freq(word), например посчитанными по всему корпусу,
+	// когда он разделен между несколькими серверами. После изменения индекса такой запрос
+	// не пересчитывается с местными IDF: поиск с ним бросает runtime_error
+	PreparedQuery PrepareQuery(std::string_view raw_query,
+		const std::function<double(std::string_view)>& inverse_document_freq) const;
+
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate,
+		size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(const PreparedQuery& query, const DocumentFilter& filter,
+		size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentStatus status,
+		size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(const PreparedQuery& query) const;
+
+	// Пакет запросов за один общий проход по спискам вхождений: список слова, которое встречается
+	// в нескольких запросах пакета, читается один раз. Результаты - в порядке queries и совпадают
+	// с FindTopDocuments по каждому запросу отдельно
+	std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<BatchQuery>& queries) const;
+
+	template <typename DocumentPredicate>
+	const std::vector<Document>& FindTopDocuments(QueryContext& context, const PreparedQuery& query,
+		DocumentPredicate document_predicate, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	const std::vector<Document>& FindTopDocuments(QueryContext& context, const PreparedQuery& query,
+		const DocumentFilter& filter, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	const std::vector<Document>& FindTopDocuments(QueryContext& context, const PreparedQuery& query,
+		DocumentStatus status, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	const std::vector<Document>& FindTopDocuments(QueryContext& context, const PreparedQuery& query) const;
     
+	// policy - std::execution::seq, std::execution::par или ThreadPool::Policy для выполнения в пуле
 	template <typename DocumentPredicate, class ExecutionPolicy>
-	std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
+	std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate,
+		size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
 	template <class ExecutionPolicy>
-	std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentStatus status) const ;
+	std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, const DocumentFilter& filter,
+		size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	template <class ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentStatus status,
+		size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
 	template <class ExecutionPolicy>
 	std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query) const;
     
@@ -61,6 +168,14 @@ public:
 	std::set<int>::const_iterator end() const;
 
 	int GetDocumentCount() const;
+	// Растет при каждом изменении набора документов
+	uint64_t GetGeneration() const;
+	// Номер экземпляра, уникальный в пределах процесса. Вместе с поколением однозначно задает
+	// состояние индекса: копия, перемещение и загрузка снимка получают новый номер, поэтому
+	// одинаковое поколение у разных серверов или у сервера по прежнему адресу ничего не значит
+	uint64_t GetInstanceId() const;
+	// Число документов, в которых встречается слово
+	int GetDocumentFrequency(std::string_view word) const;
 	std::map<std::set<string>, std::vector<int>> GetInfo(int document_id);
 	const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
 
@@ -72,22 +187,159 @@ public:
 	MatchedDocuments MatchDocument(const std::string_view raw_query, int document_id) const;
 	MatchedDocuments MatchDocument(std::execution::sequenced_policy seq, const std::string_view raw_query, int document_id) const;
 	MatchedDocuments MatchDocument(std::execution::parallel_policy par, const std::string_view raw_query, int document_id) const;
+	std::tuple<const std::vector<std::string_view>&, DocumentStatus> MatchDocument(
+		QueryContext& context, std::string_view raw_query, int document_id) const;
+	MatchedDocuments MatchDocument(const PreparedQuery& query, int document_id) const;
+	std::tuple<const std::vector<std::string_view>&, DocumentStatus> MatchDocument(
+		QueryContext& context, const PreparedQuery& query, int document_id) const;
+
+	// Совпадения запроса сразу для многих документов, результаты в порядке document_ids.
+	// Запрос разбирается один раз, а список вхождений каждого слова проходится один раз
+	// слиянием с отсортированными индексами документов
+	std::vector<MatchedDocuments> MatchDocuments(std::string_view raw_query, const std::vector<int>& document_ids) const;
+	std::vector<MatchedDocuments> MatchDocuments(std::execution::sequenced_policy seq, std::string_view raw_query,
+		const std::vector<int>& document_ids) const;
+	std::vector<MatchedDocuments> MatchDocuments(std::execution::parallel_policy par, std::string_view raw_query,
+		const std::vector<int>& document_ids) const;
+
+	// Бинарный снимок индекса: словарь, списки вхождений, метаданные и тексты документов.
+	// Сохраняются только живые документы. Загрузка отображает файл в память, проверяет его и копирует
+	// списки вхождений, столбцы и тексты массивами, без повторного разбора текстов, поэтому время
+	// загрузки линейно по размеру файла. Частоты слов документа (GetWordFrequencies) собираются
+	// из плоского массива при первом обращении к документу.
+	void SaveSnapshot(const std::string& path) const;
+	static SearchServer LoadSnapshot(const std::string& path);
     
 private:
-	struct DocumentData {
-		int rating;
-		DocumentStatus status;
-		std::string text;
-	};
 	const std::set<std::string, std::less<>> stop_words_;
-	std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-	std::map<int, DocumentData> documents_;
+	TermDictionary terms_;
+	// Списки вхождений и частоты слов документа разделяются между копиями сервера
+	// и копируются только при изменении (см. GetMutablePostings)
+	std::vector<std::shared_ptr<PostingList>> word_to_document_freqs_;
+	// Метаданные документов хранятся по столбцам, номер строки - плотный внутренний индекс документа.
+	// Именно он хранится в списках вхождений.
+	// Удаленный документ только помечается в removed_, его вхождения остаются в списках, а запросы
+	// его пропускают. Когда удаленных строк становится больше, чем живых, CompactDocuments
+	// перенумеровывает живые документы и переписывает все списки за один проход.
+	std::vector<int> index_to_document_id_;
+	std::vector<int> ratings_;
+	std::vector<DocumentStatus> statuses_;
+	// Тексты лежат в арене; строка удаленного документа пустая.
+	// Уплотнение переносит тексты, поэтому хранить string_view на них может только сам сервер
+	DocumentTextArena text_arena_;
+	std::vector<std::string_view> texts_;
+	std::vector<uint64_t> removed_;
+	uint32_t removed_count_ = 0;
+	std::map<int, uint32_t> document_indexes_;
 	std::set<int> document_ids_;
-	std::map<int, std::map<std::string_view, double>> freqs_;
+	// Число живых документов со словом; в списке вхождений могут быть еще и удаленные
+	std::vector<uint32_t> document_freqs_;
+	using WordFrequencies = std::map<std::string_view, double>;
+	// У документов из снимка значение пустое: их частоты лежат в snapshot_word_frequencies_
+	std::map<int, std::shared_ptr<const WordFrequencies>> freqs_;
+	struct SnapshotWordFrequencies;
+	std::shared_ptr<const SnapshotWordFrequencies> snapshot_word_frequencies_;
+	RankingMode ranking_mode_ = RankingMode::EXHAUSTIVE;
+	PostingFormat posting_format_ = PostingFormat::PLAIN;
+
+	// IDF зависит от числа документов, поэтому любое изменение корпуса увеличивает поколение,
+	// а значение в кэше пересчитывается при первом обращении в новом поколении.
+	// Запросы читают кэш из нескольких потоков, отсюда атомарные поля.
+	struct InverseDocumentFreq {
+		std::atomic<uint64_t> generation{NO_GENERATION};
+		std::atomic<double> value{0.0};
+
+		InverseDocumentFreq() = default;
+		InverseDocumentFreq(const InverseDocumentFreq& other)
+			: generation(other.generation.load(std::memory_order_acquire))
+			, value(other.value.load(std::memory_order_relaxed)) {
+		}
+	};
+	static constexpr uint64_t NO_GENERATION = std::numeric_limits<uint64_t>::max();
+	uint64_t generation_ = 0;
+
+	// Копирование и присваивание выдают новый номер, чтобы сервер копировался и перемещался
+	// конструкторами по умолчанию
+	class InstanceId {
+	public:
+		InstanceId()
+			: value_(Next()) {
+		}
+		InstanceId(const InstanceId&)
+			: value_(Next()) {
+		}
+		InstanceId& operator=(const InstanceId&) {
+			value_ = Next();
+			return *this;
+		}
+
+		uint64_t Get() const {
+			return value_;
+		}
+
+	private:
+		static uint64_t Next() {
+			static std::atomic<uint64_t> next_value{1};
+			return next_value.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		uint64_t value_;
+	};
+	InstanceId instance_id_;
+	mutable std::deque<InverseDocumentFreq> inverse_document_freqs_;
+
+	static constexpr uint32_t MAX_SCORE_WINDOW_SIZE = 4096;
+	static constexpr size_t MAX_SCORE_SPARSE_WINDOW_RATIO = 16;
+	static constexpr uint32_t MIN_PARALLEL_CHUNK_SIZE = 1024;
+	static constexpr size_t FILTER_BITMAP_RATIO = 8;
+	static constexpr size_t MIN_TEXT_COMPACTION_BYTES = 4 * 1024 * 1024;
+	static constexpr size_t MIN_PARALLEL_MATCH_CHUNK_SIZE = 64;
+	static constexpr size_t BATCH_WINDOW_BYTES = 256 * 1024;
+	static constexpr uint32_t MIN_DOCUMENT_COMPACTION_COUNT = 1024;
+	static constexpr uint32_t MIN_BATCH_WINDOW_SIZE = 64;
 
 	bool IsStopWord(std::string_view word) const;
+	void ReleaseDocumentText(uint32_t document_index);
+	const WordFrequencies& GetSnapshotWordFrequencies(int document_id) const;
+	void ValidateNewDocumentIds(const std::vector<NewDocument>& documents) const;
+
+	bool IsRemoved(uint32_t document_index) const {
+		return ((removed_[document_index / 64] >> (document_index % 64)) & 1) != 0;
+	}
+	void CompactDocuments(std::execution::sequenced_policy seq);
+	void CompactDocuments(std::execution::parallel_policy par);
+	template <class ExecutionPolicy>
+	void CompactDocumentsImpl(ExecutionPolicy policy);
 
-	static bool IsValidWord(std::string word);
+	const PostingList& GetPostings(TermId term) const {
+		return *word_to_document_freqs_[term];
+	}
+	PostingList& GetMutablePostings(TermId term) {
+		return Unshare(word_to_document_freqs_[term]);
+	}
+	// Список, который видит еще одна копия сервера, перед изменением копируется.
+	// Копии создаются только пишущим потоком, поэтому счетчик ссылок здесь не может вырасти
+	static PostingList& Unshare(std::shared_ptr<PostingList>& postings) {
+		if (postings.use_count() > 1) {
+			postings = std::make_shared<PostingList>(*postings);
+		}
+		return *postings;
+	}
+
+	TermId InternTerm(std::string_view word);
+
+	template <class ExecutionPolicy>
+	void AddDocumentsImpl(ExecutionPolicy policy, const std::vector<NewDocument>& documents);
+	template <class ExecutionPolicy>
+	std::vector<MatchedDocuments> MatchDocumentsImpl(ExecutionPolicy policy, std::string_view raw_query,
+		const std::vector<int>& document_ids) const;
+
+	Document MakeDocument(uint32_t document_index, double relevance) const {
+		return {index_to_document_id_[document_index], relevance, ratings_[document_index]};
+	}
+	bool ContainsTerm(TermId term, uint32_t document_index) const;
+
+	static bool IsValidWord(std::string_view word);
 
 	std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
 
@@ -99,41 +351,151 @@ private:
 		bool is_stop;
 	};
 
+	// Слово уже проверено ForEachWord на управляющие символы
 	QueryWord ParseQueryWord(std::string_view text) const;
 
-	struct Query {
-		std::vector<std::string_view> plus_words;
-		std::vector<std::string_view> minus_words;
-	};
+	using Query = ParsedQuery;
 
 	Query ParseQuery(std::string_view text, bool sorted) const;
+	void ParseQuery(std::string_view text, bool sorted, std::vector<std::string_view>& words, Query& result) const;
+	// Разбирает запрос в context вместе с IDF слов
+	void ParseQuery(std::string_view text, QueryContext& context) const;
+	// Переносит в context подготовленный запрос или разбирает его текст заново, если индекс изменился
+	void LoadPreparedQuery(const PreparedQuery& query, QueryContext& context) const;
+	std::tuple<const std::vector<std::string_view>&, DocumentStatus> MatchQuery(QueryContext& context, uint32_t document_index) const;
+
+	double ComputeWordInverseDocumentFreq(TermId term) const {
+		InverseDocumentFreq& cached = inverse_document_freqs_[term];
+		if (cached.generation.load(std::memory_order_acquire) == generation_) {
+			return cached.value.load(std::memory_order_relaxed);
+		}
+		// У слова, все документы которого удалены, вклад нулевой: живых вхождений у него нет
+		const double value = document_freqs_[term] == 0 ? 0.0 : std::log(GetDocumentCount() * 1.0 / document_freqs_[term]);
+		cached.value.store(value, std::memory_order_relaxed);
+		cached.generation.store(generation_, std::memory_order_release);
+		return value;
+	}
 
-	double ComputeWordInverseDocumentFreq(const string_view word) const {
-		return std::log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+	// Предикаты ниже принимают внутренний индекс документа
+	// Последовательное ранжирование запроса context.query_ с IDF из context.inverse_document_freqs_
+	// в context.result_
+	template <typename IndexPredicate>
+	void RankDocuments(QueryContext& context, IndexPredicate index_predicate, size_t max_count) const;
+	template <typename IndexPredicate, class ExecutionPolicy>
+	std::vector<Document> RankDocuments(ExecutionPolicy policy, const Query& query, IndexPredicate index_predicate, size_t max_count) const;
+
+	// Документы с минус-словами собираются в битовую карту до подсчета релевантности
+	// и отсекаются вместе с предикатом, до того как их вхождения будут учтены
+	DocumentBitmap BuildExcludedDocuments(const Query& query) const;
+	// Последовательный путь отмечает их в плотной маске контекста и снимает отметки после запроса
+	void MarkExcludedDocuments(QueryContext& context, bool is_excluded) const;
+
+	template <typename IndexPredicate>
+	auto ExcludeDocuments(const DocumentBitmap& excluded_documents, IndexPredicate& index_predicate) const {
+		return [this, &excluded_documents, &index_predicate](uint32_t document_index) {
+			return !IsRemoved(document_index) && !excluded_documents.Contains(document_index) && index_predicate(document_index);
+		};
 	}
 
 	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
-	template <typename DocumentPredicate, class ExecutionPolicy>
-	std::vector<Document> FindAllDocuments(ExecutionPolicy policy, const Query& query, DocumentPredicate document_predicate) const;
+	auto MakeIndexPredicate(DocumentPredicate& document_predicate) const {
+		return [this, &document_predicate](uint32_t document_index) {
+			return document_predicate(index_to_document_id_[document_index], statuses_[document_index], ratings_[document_index]);
+		};
+	}
+
+	// Фильтр проверяется либо заранее по всем документам сразу (битовая маска),
+	// либо по столбцам для каждого вхождения, если вхождений в запросе мало
+	template <typename Ranker>
+	auto RankFiltered(const Query& query, const DocumentFilter& filter, std::vector<uint64_t>& bitmap, Ranker ranker) const;
+	void BuildFilterBitmap(const DocumentFilter& filter, std::vector<uint64_t>& bitmap) const;
+
+	template <typename IndexPredicate>
+	void FindAllDocuments(QueryContext& context, IndexPredicate index_predicate) const;
+	template <typename IndexPredicate, class ExecutionPolicy>
+	void FindAllDocuments(ExecutionPolicy policy, const Query& query, IndexPredicate index_predicate, TopDocuments& top_documents) const;
+	template <typename IndexPredicate>
+	void FindTopDocumentsMaxScore(QueryContext& context, IndexPredicate index_predicate) const;
 };
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
-	const auto query = ParseQuery(raw_query, true);
-	auto matched_documents = FindAllDocuments(query, document_predicate);
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t max_count) const {
+	ThreadQueryContext context;
+	return FindTopDocuments(context.Get(), raw_query, document_predicate, max_count);
+}
 
-	std::sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-		if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-			return lhs.rating > rhs.rating;
-		} else {
-			return lhs.relevance > rhs.relevance;
-		}
-	});
-	if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+template <typename DocumentPredicate>
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryContext& context, std::string_view raw_query,
+	DocumentPredicate document_predicate, size_t max_count) const {
+	ParseQuery(raw_query, context);
+	RankDocuments(context, MakeIndexPredicate(document_predicate), max_count);
+	return context.result_;
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate, size_t max_count) const {
+	ThreadQueryContext context;
+	return FindTopDocuments(context.Get(), query, document_predicate, max_count);
+}
+
+template <typename DocumentPredicate>
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryContext& context, const PreparedQuery& query,
+	DocumentPredicate document_predicate, size_t max_count) const {
+	LoadPreparedQuery(query, context);
+	RankDocuments(context, MakeIndexPredicate(document_predicate), max_count);
+	return context.result_;
+}
+
+template <typename IndexPredicate>
+void SearchServer::RankDocuments(QueryContext& context, IndexPredicate index_predicate, size_t max_count) const {
+	context.top_documents_.Reset(max_count);
+	// Предикат мог бросить исключение посреди прошлого запроса, и плотные массивы остались грязными
+	if (context.is_ranking_) {
+		std::fill(context.relevance_.begin(), context.relevance_.end(), 0.0);
+		std::fill(context.is_matched_.begin(), context.is_matched_.end(), 0);
+		std::fill(context.excluded_.begin(), context.excluded_.end(), 0);
 	}
-	return matched_documents;
+	context.is_ranking_ = true;
+	MarkExcludedDocuments(context, true);
+	const std::vector<uint64_t>& excluded = context.excluded_;
+	const std::vector<uint64_t>& removed = removed_;
+	auto predicate = [&excluded, &removed, &index_predicate](uint32_t document_index) {
+		return (((excluded[document_index / 64] | removed[document_index / 64]) >> (document_index % 64)) & 1) == 0
+			&& index_predicate(document_index);
+	};
+	if (ranking_mode_ == RankingMode::MAX_SCORE) {
+		FindTopDocumentsMaxScore(context, predicate);
+	} else {
+		FindAllDocuments(context, predicate);
+	}
+	MarkExcludedDocuments(context, false);
+	context.is_ranking_ = false;
+	context.top_documents_.ExtractTo(context.result_);
+}
+
+template <typename IndexPredicate, class ExecutionPolicy>
+std::vector<Document> SearchServer::RankDocuments(ExecutionPolicy policy, const Query& query, IndexPredicate index_predicate, size_t max_count) const {
+	const DocumentBitmap excluded_documents = BuildExcludedDocuments(query);
+	TopDocuments top_documents(max_count);
+	FindAllDocuments(policy, query, ExcludeDocuments(excluded_documents, index_predicate), top_documents);
+	return top_documents.Extract();
+}
+
+template <typename Ranker>
+auto SearchServer::RankFiltered(const Query& query, const DocumentFilter& filter, std::vector<uint64_t>& bitmap, Ranker ranker) const {
+	size_t posting_count = 0;
+	for (const TermId term : query.plus_terms) {
+		posting_count += GetPostings(term).size();
+	}
+	if (posting_count * FILTER_BITMAP_RATIO >= index_to_document_id_.size()) {
+		BuildFilterBitmap(filter, bitmap);
+		return ranker([&bitmap](uint32_t document_index) {
+			return ((bitmap[document_index / 64] >> (document_index % 64)) & 1) != 0;
+		});
+	}
+	return ranker([this, &filter](uint32_t document_index) {
+		return filter.Matches(statuses_[document_index], ratings_[document_index]);
+	});
 }
 
 template <typename StringContainer>
@@ -145,129 +507,276 @@ SearchServer::SearchServer(const StringContainer& stop_words)
 	}
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-	std::map<int, double> document_to_relevance;
-	for (const std::string_view word : query.plus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
-			continue;
-		}
-		const double inverse_document_freq = ComputeWordInverseDocumentFreq(string(word));
-		for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-			const auto& document_data = documents_.at(document_id);
-			if (document_predicate(document_id, document_data.status, document_data.rating)) {
-				document_to_relevance[document_id] += term_freq * inverse_document_freq;
+template <typename IndexPredicate>
+void SearchServer::FindAllDocuments(QueryContext& context, IndexPredicate index_predicate) const {
+	std::vector<double>& document_to_relevance = context.relevance_;
+	std::vector<char>& is_matched = context.is_matched_;
+	std::vector<uint32_t>& matched_indexes = context.matched_indexes_;
+	document_to_relevance.resize(index_to_document_id_.size());
+	is_matched.resize(index_to_document_id_.size());
+	matched_indexes.clear();
+	// Минус-слова уже учтены в index_predicate
+	for (size_t i = 0; i < context.query_.plus_terms.size(); ++i) {
+		TRACE_STAGE(TraceStage::POSTINGS);
+		const double inverse_document_freq = context.inverse_document_freqs_[i];
+		const PostingList& postings = GetPostings(context.query_.plus_terms[i]);
+		TRACE_COUNT(TraceCounter::POSTINGS_SCANNED, postings.size());
+		for (const auto [document_index, term_freq] : postings) {
+			if (index_predicate(document_index)) {
+				if (!is_matched[document_index]) {
+					is_matched[document_index] = true;
+					matched_indexes.push_back(document_index);
+				}
+				document_to_relevance[document_index] += term_freq * inverse_document_freq;
 			}
 		}
 	}
 
-	for (const string_view word : query.minus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
-			continue;
-		}
-		for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-			document_to_relevance.erase(document_id);
-		}
-	}
-
-	std::vector<Document> matched_documents;
-	for (const auto [document_id, relevance] : document_to_relevance) {
-		matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+	TRACE_STAGE(TraceStage::TOP_DOCUMENTS);
+	TRACE_COUNT(TraceCounter::DOCUMENTS_SCORED, matched_indexes.size());
+	for (const uint32_t document_index : matched_indexes) {
+		context.top_documents_.Add(MakeDocument(document_index, document_to_relevance[document_index]));
+		document_to_relevance[document_index] = 0.0;
+		is_matched[document_index] = false;
 	}
-	return matched_documents;
 }
 
-	template <typename DocumentPredicate, class ExecutionPolicy>
-	std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy policy, const Query& query, DocumentPredicate document_predicate) const{ 
+// Диапазон внутренних индексов делится на отрезки. Каждый отрезок целиком обрабатывает один поток:
+// считает релевантность в свой плотный массив и отбирает свой топ, поэтому блокировки не нужны.
+template <typename IndexPredicate, class ExecutionPolicy>
+void SearchServer::FindAllDocuments(ExecutionPolicy policy, const Query& query, IndexPredicate index_predicate, TopDocuments& top_documents) const {
+	const uint32_t document_count = index_to_document_id_.size();
+	const uint32_t max_chunk_count = std::max(1u, std::thread::hardware_concurrency()) * 4;
+	const uint32_t chunk_size = std::max(MIN_PARALLEL_CHUNK_SIZE, (document_count + max_chunk_count - 1) / max_chunk_count);
+	std::vector<uint32_t> chunk_begins((document_count + chunk_size - 1) / chunk_size);
+	for (size_t i = 0; i < chunk_begins.size(); ++i) {
+		chunk_begins[i] = static_cast<uint32_t>(i) * chunk_size;
+	}
 
-	ConcurrentMap<int, double> document_to_relevance(8);
+	std::vector<double> inverse_document_freqs(query.plus_terms.size());
+	std::transform(query.plus_terms.begin(), query.plus_terms.end(), inverse_document_freqs.begin(), [this](const TermId term) {
+		return ComputeWordInverseDocumentFreq(term);
+	});
 
-	std::for_each (policy, query.plus_words.begin(), query.plus_words.end(), [this, &document_predicate, &document_to_relevance] (const auto word) {
-		if (word_to_document_freqs_.count(word) != 0) {
-			const double inverse_document_freq = ComputeWordInverseDocumentFreq(string(word));
-			for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-				const auto& document_data = documents_.at(document_id);
-				if (document_predicate(document_id, document_data.status, document_data.rating)) {
-					document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
+	std::vector<TopDocuments> chunk_top_documents(chunk_begins.size(), TopDocuments(top_documents.GetMaxCount()));
+	ForEach(policy, chunk_begins.begin(), chunk_begins.end(), [&](const uint32_t chunk_begin) {
+		const uint32_t chunk_end = std::min(document_count, chunk_begin + chunk_size);
+		std::vector<double> document_to_relevance(chunk_end - chunk_begin);
+		std::vector<char> is_matched(chunk_end - chunk_begin);
+
+		for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+			TRACE_STAGE(TraceStage::POSTINGS);
+			const PostingList& postings = GetPostings(query.plus_terms[i]);
+			[[maybe_unused]] size_t postings_scanned = 0;
+			for (auto it = postings.LowerBound(chunk_begin); it != postings.end() && it->document_index < chunk_end; ++it) {
+				++postings_scanned;
+				if (index_predicate(it->document_index)) {
+					is_matched[it->document_index - chunk_begin] = true;
+					document_to_relevance[it->document_index - chunk_begin] += it->term_freq * inverse_document_freqs[i];
 				}
 			}
+			TRACE_COUNT(TraceCounter::POSTINGS_SCANNED, postings_scanned);
+		}
+
+		TRACE_STAGE(TraceStage::TOP_DOCUMENTS);
+		TopDocuments& chunk_top = chunk_top_documents[chunk_begin / chunk_size];
+		[[maybe_unused]] size_t documents_scored = 0;
+		for (uint32_t offset = 0; offset < chunk_end - chunk_begin; ++offset) {
+			if (is_matched[offset]) {
+				++documents_scored;
+				chunk_top.Add(MakeDocument(chunk_begin + offset, document_to_relevance[offset]));
+			}
 		}
+		TRACE_COUNT(TraceCounter::DOCUMENTS_SCORED, documents_scored);
 	});
-    	
-	std::for_each (policy, query.minus_words.begin(), query.minus_words.end(), [this, &document_to_relevance] (const auto word) {
-		if (!word_to_document_freqs_.count(word)) {
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-                document_to_relevance[document_id].ref_to_value = 0;
-            }
-        }
-	});	
- 	
-	/*К сожалению из-за своих изменений получил следующее сообщение в тренажере:
-
-parallel method too slow, student/author ratio: 1.8953063121087388
-Задача прошла 24/25 проверок
-
-Возможные проблемы:
-- Неправильно распараллелен метод FindTopDocuments
-
-*/
-
-    std::vector<Document> matched_documents;
-	for(auto [id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
-		if(document_to_relevance[id].ref_to_value != 0) {
-			matched_documents.push_back({id, document_to_relevance[id].ref_to_value, documents_.at(id).rating});
+
+	for (TopDocuments& chunk_top : chunk_top_documents) {
+		for (const Document& document : chunk_top.Extract()) {
+			top_documents.Add(document);
 		}
 	}
-
-	return matched_documents;
 }
     
 
+// Алгоритм MaxScore: слова упорядочены по верхней оценке вклада max_tf * idf.
+// Слова с наименьшими оценками, сумма которых не дотягивает до порога топа, - "необязательные":
+// кандидаты берутся только из списков обязательных слов, а необязательные дочитываются
+// бинарным поиском, пока документ еще может пройти порог.
+template <typename IndexPredicate>
+void SearchServer::FindTopDocumentsMaxScore(QueryContext& context, IndexPredicate index_predicate) const {
+	using TermCursor = QueryContext::TermCursor;
+	TopDocuments& top_documents = context.top_documents_;
+	std::vector<TermCursor>& cursors = context.cursors_;
+	cursors.clear();
+	for (size_t i = 0; i < context.query_.plus_terms.size(); ++i) {
+		const TermId term = context.query_.plus_terms[i];
+		if (document_freqs_[term] == 0) {
+			continue;
+		}
+		const PostingList& postings = GetPostings(term);
+		const double inverse_document_freq = context.inverse_document_freqs_[i];
+		cursors.push_back({&postings, postings.begin(), inverse_document_freq, postings.GetMaxTermFreq() * inverse_document_freq});
+	}
+	std::sort(cursors.begin(), cursors.end(), [](const TermCursor& lhs, const TermCursor& rhs) {
+		return lhs.max_score < rhs.max_score;
+	});
+	// max_score_sums[i] - верхняя оценка документа, который встречается только в словах 0..i
+	std::vector<double>& max_score_sums = context.max_score_sums_;
+	max_score_sums.resize(cursors.size());
+	double max_score_sum = 0.0;
+	for (size_t i = 0; i < cursors.size(); ++i) {
+		max_score_sum += cursors[i].max_score;
+		max_score_sums[i] = max_score_sum;
+	}
+
+	// Обязательные слова считаются по окнам внутренних индексов в плотный массив,
+	// затем кандидаты окна дочитываются по необязательным словам.
+	// Обход и отбор здесь не разделить, поэтому весь проход замеряется как один этап
+	TRACE_STAGE(TraceStage::POSTINGS);
+	const uint32_t document_count = index_to_document_id_.size();
+	// Окно пользуется теми же обнуленными массивами, что и полный подсчет.
+	// Предикат (с минус-словами) проверяется один раз, при первом вхождении документа в окно,
+	// и отброшенный документ дальше не считается
+	constexpr char NOT_SEEN = 0;
+	constexpr char ACCEPTED = 1;
+	constexpr char REJECTED = 2;
+	std::vector<double>& window_relevance = context.relevance_;
+	std::vector<char>& window_states = context.is_matched_;
+	// Смещения документов окна, впервые встреченных в обязательных словах
+	std::vector<uint32_t>& window_candidates = context.matched_indexes_;
+	// Вхождения обязательных слов и вхождения необязательных, найденные дочитыванием
+	[[maybe_unused]] size_t postings_scanned = 0;
+	[[maybe_unused]] size_t documents_scored = 0;
+	[[maybe_unused]] size_t windows_scanned = 0;
+	window_relevance.resize(std::max<size_t>(window_relevance.size(), MAX_SCORE_WINDOW_SIZE));
+	window_states.resize(std::max<size_t>(window_states.size(), MAX_SCORE_WINDOW_SIZE));
+	size_t first_essential = 0;
+	while (true) {
+		while (first_essential < cursors.size() && max_score_sums[first_essential] < top_documents.GetThreshold()) {
+			++first_essential;
+		}
+		// Окно начинается с ближайшего непрочитанного вхождения обязательных слов:
+		// участки индексов без их вхождений не посещаются, и запрос из редких слов
+		// стоит O(вхождений), а не O(документов)
+		uint32_t window_begin = document_count;
+		for (size_t i = first_essential; i < cursors.size(); ++i) {
+			const TermCursor& cursor = cursors[i];
+			if (cursor.it != cursor.postings->end()) {
+				window_begin = std::min(window_begin, cursor.it->document_index);
+			}
+		}
+		if (window_begin == document_count) {
+			break;
+		}
+		const uint32_t window_end = std::min<uint64_t>(document_count, uint64_t{window_begin} + MAX_SCORE_WINDOW_SIZE);
+		++windows_scanned;
+
+		window_candidates.clear();
+		for (size_t i = first_essential; i < cursors.size(); ++i) {
+			TermCursor& cursor = cursors[i];
+			for (; cursor.it != cursor.postings->end() && cursor.it->document_index < window_end; ++cursor.it) {
+				++postings_scanned;
+				const uint32_t offset = cursor.it->document_index - window_begin;
+				char& state = window_states[offset];
+				if (state == NOT_SEEN) {
+					state = index_predicate(cursor.it->document_index) ? ACCEPTED : REJECTED;
+					window_candidates.push_back(offset);
+				}
+				if (state == ACCEPTED) {
+					window_relevance[offset] += cursor.it->term_freq * cursor.inverse_document_freq;
+				}
+			}
+		}
+
+		// Кандидаты дочитываются по возрастанию индекса: курсоры необязательных слов идут только вперед
+		const auto score_candidate = [&](uint32_t offset) {
+			const char state = window_states[offset];
+			window_states[offset] = NOT_SEEN;
+			if (state == REJECTED) {
+				return;
+			}
+			double relevance = window_relevance[offset];
+			window_relevance[offset] = 0.0;
+			++documents_scored;
+
+			const uint32_t document_index = window_begin + offset;
+			const double threshold = top_documents.GetThreshold();
+			for (size_t i = first_essential; i-- > 0;) {
+				if (relevance + max_score_sums[i] < threshold) {
+					return;
+				}
+				TermCursor& cursor = cursors[i];
+				cursor.postings->SkipTo(cursor.it, document_index);
+				if (cursor.it != cursor.postings->end() && cursor.it->document_index == document_index) {
+					++postings_scanned;
+					relevance += cursor.it->term_freq * cursor.inverse_document_freq;
+				}
+			}
+			top_documents.Add(MakeDocument(document_index, relevance));
+		};
+		// Редкие кандидаты дешевле отсортировать, чем просматривать все окно
+		if (window_candidates.size() * MAX_SCORE_SPARSE_WINDOW_RATIO < window_end - window_begin) {
+			std::sort(window_candidates.begin(), window_candidates.end());
+			for (const uint32_t offset : window_candidates) {
+				score_candidate(offset);
+			}
+		} else {
+			for (uint32_t offset = 0; offset < window_end - window_begin; ++offset) {
+				if (window_states[offset] != NOT_SEEN) {
+					score_candidate(offset);
+				}
+			}
+		}
+	}
+	TRACE_COUNT(TraceCounter::MAX_SCORE_WINDOWS, windows_scanned);
+	TRACE_COUNT(TraceCounter::POSTINGS_SCANNED, postings_scanned);
+	TRACE_COUNT(TraceCounter::DOCUMENTS_SCORED, documents_scored);
+}
+
 template <class ExecutionPolicy>
 void SearchServer::RemoveDocument(ExecutionPolicy policy, int document_id) {
-	if (documents_.count(document_id) == 0) {
+	const auto index_it = document_indexes_.find(document_id);
+	if (index_it == document_indexes_.end()) {
 		return;
 	}
-	std::map<std::string_view, double>& query = freqs_.at(document_id);
-	vector<std::string_view> words(query.size());
-	std::transform(policy, query.begin(), query.end(), words.begin(), 
-	[](const auto& info) {
-		return string_view(info.first);
-	});
-
-	std::for_each(policy, words.begin(), words.end(), [&](const auto& word) {
-		word_to_document_freqs_.at(word.data()).erase(document_id);
-	});
+	const uint32_t document_index = index_it->second;
+	// Списки вхождений не трогаем: вычеркивание из середины массива стоило бы O(df) на слово
+	for (const auto& [word, _] : GetWordFrequencies(document_id)) {
+		--document_freqs_[terms_.Find(word)];
+	}
+	removed_[document_index / 64] |= uint64_t{1} << (document_index % 64);
+	++removed_count_;
 
-	documents_.erase(document_id);
+	document_indexes_.erase(index_it);
 	freqs_.erase(document_id);
 	document_ids_.erase(document_id);
+	ReleaseDocumentText(document_index);
+	++generation_;
+	// Уплотнение переписывает все списки, поэтому запускается, только когда удаленных строк
+	// не меньше живых: на каждый удаленный документ приходится O(его вхождений) работы
+	if (removed_count_ >= std::max<size_t>(MIN_DOCUMENT_COMPACTION_COUNT, document_indexes_.size())) {
+		CompactDocuments(policy);
+	}
 }
 
 template <typename DocumentPredicate, class ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate) const {
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate, size_t max_count) const {
 	const auto query = ParseQuery(raw_query, true);
-	auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+	return RankDocuments(policy, query, MakeIndexPredicate(document_predicate), max_count);
+}
 
-	std::sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-		if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-			return lhs.rating > rhs.rating;
-		} else {
-			return lhs.relevance > rhs.relevance;
-		}
+template <class ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, const DocumentFilter& filter, size_t max_count) const {
+	const auto query = ParseQuery(raw_query, true);
+	std::vector<uint64_t> bitmap;
+	return RankFiltered(query, filter, bitmap, [&](auto index_predicate) {
+		return RankDocuments(policy, query, index_predicate, max_count);
 	});
-	if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-	}
-
-	return matched_documents;
 }
 
 template <class ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentStatus status) const {
-	return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-		return document_status == status;
-	});
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentStatus status, size_t max_count) const {
+	return FindTopDocuments(policy, raw_query, DocumentFilter().SetStatuses({status}), max_count);
 }
 
 template <class ExecutionPolicy>
@@ -0,0 +1,390 @@
+#include "search_server.h"
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+// Формат снимка: заголовок, за ним секции - плоские массивы, выровненные на 8 байт.
+// Все ссылки внутри файла - смещения от его начала, поэтому файл можно отобразить по любому адресу.
+// Строки (стоп-слова, термы, тексты) хранятся как массив смещений uint64 длиной count + 1 и общий блок символов.
+constexpr char SNAPSHOT_MAGIC[8] = {'S', 'R', 'C', 'H', 'S', 'N', 'A', 'P'};
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct StringsSection {
+	uint64_t count;
+	uint64_t offsets;
+	uint64_t chars;
+};
+
+struct SnapshotHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint64_t file_size;
+
+	StringsSection stop_words;
+	StringsSection terms;
+
+	// posting_offsets[term] .. posting_offsets[term + 1] - вхождения терма в массивах ниже
+	uint64_t posting_count;
+	uint64_t posting_offsets;
+	uint64_t posting_document_indexes;
+	uint64_t posting_term_freqs;
+
+	// Столбцы по внутреннему индексу документа. SaveSnapshot пишет только живые документы,
+	// но загрузчик принимает и строки с is_alive = 0: они становятся удаленными индексами
+	uint64_t document_count;
+	uint64_t document_ids;
+	uint64_t document_ratings;
+	uint64_t document_statuses;
+	uint64_t document_is_alive;
+	StringsSection texts;
+};
+
+class SnapshotWriter {
+public:
+	SnapshotWriter() {
+		buffer_.resize(sizeof(SnapshotHeader));
+	}
+
+	template <typename T>
+	uint64_t Write(const T* data, size_t count) {
+		buffer_.resize((buffer_.size() + 7) / 8 * 8);
+		const uint64_t offset = buffer_.size();
+		buffer_.resize(offset + count * sizeof(T));
+		if (count > 0) {
+			memcpy(buffer_.data() + offset, data, count * sizeof(T));
+		}
+		return offset;
+	}
+
+	template <typename StringContainer>
+	StringsSection WriteStrings(const StringContainer& strings) {
+		vector<uint64_t> offsets = {0};
+		string chars;
+		for (string_view str : strings) {
+			chars += str;
+			offsets.push_back(chars.size());
+		}
+		StringsSection section;
+		section.count = offsets.size() - 1;
+		section.offsets = Write(offsets.data(), offsets.size());
+		section.chars = Write(chars.data(), chars.size());
+		return section;
+	}
+
+	void Save(SnapshotHeader header, const string& path) {
+		header.file_size = buffer_.size();
+		memcpy(buffer_.data(), &header, sizeof(header));
+		ofstream out(path, ios::binary | ios::trunc);
+		out.write(buffer_.data(), buffer_.size());
+		if (!out) {
+			throw runtime_error("Cannot write snapshot "s + path);
+		}
+	}
+
+private:
+	vector<char> buffer_;
+};
+
+class MappedSnapshot {
+public:
+	explicit MappedSnapshot(const string& path) {
+		const int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw runtime_error("Cannot open snapshot "s + path);
+		}
+		struct stat file_stat;
+		if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(SnapshotHeader)) {
+			close(fd);
+			throw runtime_error("Snapshot "s + path + " is truncated"s);
+		}
+		size_ = file_stat.st_size;
+		void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED) {
+			throw runtime_error("Cannot map snapshot "s + path);
+		}
+		data_ = static_cast<const char*>(data);
+
+		memcpy(&header_, data_, sizeof(header_));
+		if (memcmp(header_.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0
+			|| header_.byte_order != BYTE_ORDER_MARK || header_.file_size != size_) {
+			Unmap();
+			throw runtime_error("File "s + path + " is not a search server snapshot"s);
+		}
+		if (header_.version != SNAPSHOT_VERSION) {
+			Unmap();
+			throw runtime_error("Unsupported snapshot version "s + to_string(header_.version));
+		}
+	}
+
+	MappedSnapshot(const MappedSnapshot&) = delete;
+	MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+	~MappedSnapshot() {
+		Unmap();
+	}
+
+	const SnapshotHeader& GetHeader() const {
+		return header_;
+	}
+
+	template <typename T>
+	const T* Section(uint64_t offset, uint64_t count) const {
+		if (offset % alignof(T) != 0 || offset > size_ || count > (size_ - offset) / sizeof(T)) {
+			throw runtime_error("Snapshot section is out of bounds"s);
+		}
+		return reinterpret_cast<const T*>(data_ + offset);
+	}
+
+	vector<string_view> Strings(const StringsSection& section) const {
+		const uint64_t* offsets = Section<uint64_t>(section.offsets, section.count + 1);
+		const char* chars = Section<char>(section.chars, offsets[section.count]);
+		vector<string_view> strings;
+		strings.reserve(section.count);
+		for (uint64_t i = 0; i < section.count; ++i) {
+			if (offsets[i] > offsets[i + 1]) {
+				throw runtime_error("Snapshot string table is corrupted"s);
+			}
+			strings.emplace_back(chars + offsets[i], offsets[i + 1] - offsets[i]);
+		}
+		return strings;
+	}
+
+private:
+	void Unmap() {
+		if (data_ != nullptr) {
+			munmap(const_cast<char*>(data_), size_);
+			data_ = nullptr;
+		}
+	}
+
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+	SnapshotHeader header_;
+};
+
+}  // namespace
+
+// Частоты слов документов загруженного снимка. Разделяются копиями сервера: их словари термов
+// разделяют блоки строк, записанные при загрузке, поэтому ключи собранных словарей остаются
+// действительными в любой копии
+struct SearchServer::SnapshotWordFrequencies {
+	// Живые документы снимка по возрастанию id и их индексы в снимке
+	vector<pair<int, uint32_t>> documents;
+	// Слова документа с индексом i в порядке ключей: words[word_offsets[i] .. word_offsets[i + 1])
+	vector<uint64_t> word_offsets;
+	vector<pair<TermId, double>> words;
+	// Словарь документа documents[k] собирается один раз, при первом обращении из любого потока
+	mutable unique_ptr<once_flag[]> once;
+	mutable vector<unique_ptr<const WordFrequencies>> frequencies;
+};
+
+void SearchServer::SaveSnapshot(const string& path) const {
+	SnapshotWriter writer;
+	SnapshotHeader header = {};
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	header.version = SNAPSHOT_VERSION;
+	header.byte_order = BYTE_ORDER_MARK;
+
+	header.stop_words = writer.WriteStrings(stop_words_);
+	vector<string_view> terms(terms_.size());
+	for (TermId term = 0; term < terms.size(); ++term) {
+		terms[term] = terms_.GetTerm(term);
+	}
+	header.terms = writer.WriteStrings(terms);
+
+	// Живые документы перенумеровываются подряд, удаленные строки в снимок не попадают
+	const size_t index_count = index_to_document_id_.size();
+	vector<uint32_t> live_indexes;
+	live_indexes.reserve(document_indexes_.size());
+	vector<uint32_t> new_indexes(index_count);
+	for (uint32_t document_index = 0; document_index < index_count; ++document_index) {
+		if (!IsRemoved(document_index)) {
+			new_indexes[document_index] = static_cast<uint32_t>(live_indexes.size());
+			live_indexes.push_back(document_index);
+		}
+	}
+
+	vector<uint64_t> posting_offsets = {0};
+	vector<uint32_t> posting_document_indexes;
+	vector<double> posting_term_freqs;
+	for (const auto& postings : word_to_document_freqs_) {
+		for (const auto [document_index, term_freq] : *postings) {
+			if (IsRemoved(document_index)) {
+				continue;
+			}
+			posting_document_indexes.push_back(new_indexes[document_index]);
+			posting_term_freqs.push_back(term_freq);
+		}
+		posting_offsets.push_back(posting_document_indexes.size());
+	}
+	header.posting_count = posting_document_indexes.size();
+	header.posting_offsets = writer.Write(posting_offsets.data(), posting_offsets.size());
+	header.posting_document_indexes = writer.Write(posting_document_indexes.data(), posting_document_indexes.size());
+	header.posting_term_freqs = writer.Write(posting_term_freqs.data(), posting_term_freqs.size());
+
+	const size_t document_count = live_indexes.size();
+	vector<int32_t> document_ids(document_count);
+	vector<int32_t> ratings(document_count);
+	vector<int32_t> statuses(document_count);
+	vector<string_view> texts(document_count);
+	for (size_t i = 0; i < document_count; ++i) {
+		const uint32_t document_index = live_indexes[i];
+		document_ids[i] = index_to_document_id_[document_index];
+		ratings[i] = ratings_[document_index];
+		statuses[i] = static_cast<int32_t>(statuses_[document_index]);
+		texts[i] = texts_[document_index];
+	}
+	const vector<uint8_t> is_alive(document_count, 1);
+	header.document_count = document_count;
+	header.document_ids = writer.Write(document_ids.data(), document_count);
+	header.document_ratings = writer.Write(ratings.data(), document_count);
+	header.document_statuses = writer.Write(statuses.data(), document_count);
+	header.document_is_alive = writer.Write(is_alive.data(), document_count);
+	header.texts = writer.WriteStrings(texts);
+
+	writer.Save(header, path);
+}
+
+SearchServer SearchServer::LoadSnapshot(const string& path) {
+	const MappedSnapshot snapshot(path);
+	const SnapshotHeader& header = snapshot.GetHeader();
+
+	SearchServer server(snapshot.Strings(header.stop_words));
+
+	const vector<string_view> terms = snapshot.Strings(header.terms);
+	const uint64_t* posting_offsets = snapshot.Section<uint64_t>(header.posting_offsets, terms.size() + 1);
+	const uint32_t* posting_document_indexes = snapshot.Section<uint32_t>(header.posting_document_indexes, header.posting_count);
+	const double* posting_term_freqs = snapshot.Section<double>(header.posting_term_freqs, header.posting_count);
+	// Смещения не убывают и заканчиваются на posting_count, значит каждое лежит в [0, posting_count]
+	if (posting_offsets[0] != 0 || posting_offsets[terms.size()] != header.posting_count) {
+		throw runtime_error("Snapshot posting table is corrupted"s);
+	}
+	for (size_t i = 0; i < terms.size(); ++i) {
+		if (posting_offsets[i] > posting_offsets[i + 1]) {
+			throw runtime_error("Snapshot posting table is corrupted"s);
+		}
+	}
+
+	const uint64_t document_count = header.document_count;
+	const int32_t* document_ids = snapshot.Section<int32_t>(header.document_ids, document_count);
+	const int32_t* ratings = snapshot.Section<int32_t>(header.document_ratings, document_count);
+	const int32_t* statuses = snapshot.Section<int32_t>(header.document_statuses, document_count);
+	const uint8_t* is_alive = snapshot.Section<uint8_t>(header.document_is_alive, document_count);
+	const vector<string_view> texts = snapshot.Strings(header.texts);
+	if (texts.size() != document_count || document_count > numeric_limits<uint32_t>::max()) {
+		throw runtime_error("Snapshot document table is corrupted"s);
+	}
+	for (uint64_t document_index = 0; document_index < document_count; ++document_index) {
+		const int32_t status = statuses[document_index];
+		if (status < static_cast<int32_t>(DocumentStatus::ACTUAL) || status > static_cast<int32_t>(DocumentStatus::REMOVED)) {
+			throw runtime_error("Snapshot document status is out of range"s);
+		}
+	}
+
+	server.index_to_document_id_.assign(document_ids, document_ids + document_count);
+	server.ratings_.assign(ratings, ratings + document_count);
+	server.statuses_.resize(document_count);
+	transform(statuses, statuses + document_count, server.statuses_.begin(), [](int32_t status) {
+		return static_cast<DocumentStatus>(status);
+	});
+	server.removed_.resize((document_count + 63) / 64);
+	server.texts_.reserve(document_count);
+	for (uint64_t document_index = 0; document_index < document_count; ++document_index) {
+		server.texts_.emplace_back();
+		if (!is_alive[document_index]) {
+			server.removed_[document_index / 64] |= uint64_t{1} << (document_index % 64);
+			++server.removed_count_;
+			continue;
+		}
+		const int document_id = document_ids[document_index];
+		if (document_id < 0 || !server.document_indexes_.emplace(document_id, document_index).second) {
+			throw runtime_error("Snapshot document id is invalid or repeated"s);
+		}
+		server.document_ids_.insert(document_id);
+		server.texts_.back() = server.text_arena_.Store(texts[document_index]);
+	}
+
+	// Списки вхождений копируются массивами целиком, попутно считается число слов каждого документа
+	vector<uint64_t> document_word_offsets(document_count + 1);
+	for (size_t i = 0; i < terms.size(); ++i) {
+		const TermId term = server.InternTerm(terms[i]);
+		if (term != i) {
+			throw runtime_error("Snapshot term table has repeated terms"s);
+		}
+		const uint64_t begin = posting_offsets[i];
+		const uint64_t end = posting_offsets[i + 1];
+		for (uint64_t posting = begin; posting < end; ++posting) {
+			const uint32_t document_index = posting_document_indexes[posting];
+			if (document_index >= document_count || !is_alive[document_index]) {
+				throw runtime_error("Snapshot posting refers to a missing document"s);
+			}
+			if (posting > begin && document_index <= posting_document_indexes[posting - 1]) {
+				throw runtime_error("Snapshot posting list is not sorted"s);
+			}
+			++document_word_offsets[document_index + 1];
+		}
+		server.GetMutablePostings(term).Assign(posting_document_indexes + begin, posting_term_freqs + begin, end - begin);
+		server.document_freqs_[term] = end - begin;
+	}
+	partial_sum(document_word_offsets.begin(), document_word_offsets.end(), document_word_offsets.begin());
+
+	// Частоты слов документов: вхождения раскладываются по документам подсчетом, термы
+	// обходятся в порядке строк, поэтому слова каждого документа уже упорядочены по ключу
+	// WordFrequencies. Словарь документа собирается из этого массива при первом обращении
+	vector<TermId> terms_by_text(terms.size());
+	iota(terms_by_text.begin(), terms_by_text.end(), TermId{0});
+	sort(terms_by_text.begin(), terms_by_text.end(), [&terms](TermId lhs, TermId rhs) {
+		return terms[lhs] < terms[rhs];
+	});
+	auto word_frequencies = make_shared<SnapshotWordFrequencies>();
+	word_frequencies->words.resize(header.posting_count);
+	vector<uint64_t> next_word(document_word_offsets.begin(), document_word_offsets.end() - 1);
+	for (const TermId term : terms_by_text) {
+		for (uint64_t posting = posting_offsets[term]; posting < posting_offsets[term + 1]; ++posting) {
+			word_frequencies->words[next_word[posting_document_indexes[posting]]++] = {term, posting_term_freqs[posting]};
+		}
+	}
+	word_frequencies->word_offsets = move(document_word_offsets);
+	word_frequencies->documents.assign(server.document_indexes_.begin(), server.document_indexes_.end());
+	word_frequencies->once = make_unique<once_flag[]>(word_frequencies->documents.size());
+	word_frequencies->frequencies.resize(word_frequencies->documents.size());
+	for (const auto& [document_id, _] : word_frequencies->documents) {
+		server.freqs_.emplace_hint(server.freqs_.end(), document_id, nullptr);
+	}
+	server.snapshot_word_frequencies_ = move(word_frequencies);
+	return server;
+}
+
+const SearchServer::WordFrequencies& SearchServer::GetSnapshotWordFrequencies(int document_id) const {
+	const SnapshotWordFrequencies& snapshot = *snapshot_word_frequencies_;
+	const auto document_it = lower_bound(snapshot.documents.begin(), snapshot.documents.end(), document_id,
+		[](const pair<int, uint32_t>& document, int id) {
+			return document.first < id;
+		});
+	const size_t position = document_it - snapshot.documents.begin();
+	call_once(snapshot.once[position], [&] {
+		auto frequencies = make_unique<WordFrequencies>();
+		const uint32_t document_index = document_it->second;
+		for (uint64_t i = snapshot.word_offsets[document_index]; i < snapshot.word_offsets[document_index + 1]; ++i) {
+			frequencies->emplace_hint(frequencies->end(), terms_.GetTerm(snapshot.words[i].first), snapshot.words[i].second);
+		}
+		snapshot.frequencies[position] = move(frequencies);
+	});
+	return *snapshot.frequencies[position];
+}
@@ -0,0 +1,123 @@
+#include "sharded_search_server.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+ShardedSearchServer::ShardedSearchServer(string_view stop_words_text, size_t shard_count) {
+	if (shard_count == 0) {
+		throw invalid_argument("Shard count must be positive"s);
+	}
+	shards_.reserve(shard_count);
+	for (size_t i = 0; i < shard_count; ++i) {
+		shards_.emplace_back(stop_words_text);
+	}
+}
+
+void ShardedSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+	shards_[GetShardIndex(document_id)].AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::AddDocuments(const vector<NewDocument>& documents) {
+	vector<vector<NewDocument>> shard_documents(shards_.size());
+	for (const NewDocument& document : documents) {
+		shard_documents[GetShardIndex(document.id)].push_back(document);
+	}
+	// Сначала пакет проверяется во всех частях, чтобы ошибка в одной из них
+	// не оставила другие уже измененными
+	ForEachShard([&](size_t shard) {
+		shards_[shard].ValidateNewDocuments(shard_documents[shard]);
+	});
+	ForEachShard([&](size_t shard) {
+		shards_[shard].AddDocuments(execution::seq, shard_documents[shard]);
+	});
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+	shards_[GetShardIndex(document_id)].RemoveDocument(document_id);
+}
+
+void ShardedSearchServer::SetRankingMode(RankingMode mode) {
+	for (SearchServer& shard : shards_) {
+		shard.SetRankingMode(mode);
+	}
+}
+
+void ShardedSearchServer::SetPostingFormat(PostingFormat format) {
+	for (SearchServer& shard : shards_) {
+		shard.SetPostingFormat(format);
+	}
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query, const DocumentFilter& filter, size_t max_count) const {
+	return FindTopDocumentsImpl(raw_query, max_count,
+		[&filter](const SearchServer& shard, const PreparedQuery& query, size_t max_count) {
+			return shard.FindTopDocuments(query, filter, max_count);
+		});
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status, size_t max_count) const {
+	return FindTopDocuments(raw_query, DocumentFilter().SetStatuses({status}), max_count);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query) const {
+	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+SearchServer::MatchedDocuments ShardedSearchServer::MatchDocument(string_view raw_query, int document_id) const {
+	return shards_[GetShardIndex(document_id)].MatchDocument(raw_query, document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+	return accumulate(shards_.begin(), shards_.end(), 0, [](int count, const SearchServer& shard) {
+		return count + shard.GetDocumentCount();
+	});
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+	return shards_.size();
+}
+
+const SearchServer& ShardedSearchServer::GetShard(size_t shard) const {
+	return shards_.at(shard);
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+	// Соседние id расходятся по разным частям
+	const uint32_t hash = static_cast<uint32_t>(document_id) * 2654435761u;
+	return (static_cast<uint64_t>(hash) * shards_.size()) >> 32;
+}
+
+std::vector<PreparedQuery> ShardedSearchServer::PrepareQuery(string_view raw_query) const {
+	// Число документов со словом суммируется по частям для всех слов запроса без минуса.
+	// Некорректные и стоп-слова тоже попадут сюда, но части их отбросят или отклонят запрос
+	vector<pair<string_view, int>> document_freqs;
+	ForEachWord(raw_query, [&document_freqs](string_view word, bool) {
+		if (word[0] != '-') {
+			document_freqs.emplace_back(word, 0);
+		}
+	});
+	sort(document_freqs.begin(), document_freqs.end());
+	document_freqs.erase(unique(document_freqs.begin(), document_freqs.end()), document_freqs.end());
+	for (auto& [word, document_freq] : document_freqs) {
+		for (const SearchServer& shard : shards_) {
+			document_freq += shard.GetDocumentFrequency(word);
+		}
+	}
+
+	// Формула та же, что у одного сервера, поэтому и значения совпадают до бита
+	const double document_count = GetDocumentCount() * 1.0;
+	const auto inverse_document_freq = [&](string_view word) {
+		const auto it = lower_bound(document_freqs.begin(), document_freqs.end(), pair{word, 0});
+		return log(document_count / it->second);
+	};
+
+	vector<PreparedQuery> queries(shards_.size());
+	ForEachShard([&](size_t shard) {
+		queries[shard] = shards_[shard].PrepareQuery(raw_query, inverse_document_freq);
+	});
+	return queries;
+}
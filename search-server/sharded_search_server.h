@@ -0,0 +1,106 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <cstdint>
+#include <exception>
+#include <execution>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Корпус, разделенный между несколькими SearchServer по хешу id документа.
+// Запрос выполняется на всех частях параллельно, лучшие документы частей сливаются
+// в общий топ с тем же порядком, что у одного сервера. IDF считается по числу документов
+// во всем корпусе, поэтому релевантности совпадают с сервером, которому добавили все документы.
+class ShardedSearchServer {
+public:
+	ShardedSearchServer(std::string_view stop_words_text, size_t shard_count);
+
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+	// Документы раскладываются по частям и добавляются в них параллельно.
+	// Пакет проверяется во всех частях до изменения любой из них: некорректный документ
+	// отклоняет пакет целиком
+	void AddDocuments(const std::vector<NewDocument>& documents);
+	void RemoveDocument(int document_id);
+
+	void SetRankingMode(RankingMode mode);
+	void SetPostingFormat(PostingFormat format);
+
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+		size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, const DocumentFilter& filter,
+		size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+		size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+	SearchServer::MatchedDocuments MatchDocument(std::string_view raw_query, int document_id) const;
+
+	int GetDocumentCount() const;
+	size_t GetShardCount() const;
+	const SearchServer& GetShard(size_t shard) const;
+	size_t GetShardIndex(int document_id) const;
+
+private:
+	std::vector<SearchServer> shards_;
+
+	// Запрос, подготовленный для каждой части с IDF по всему корпусу
+	std::vector<PreparedQuery> PrepareQuery(std::string_view raw_query) const;
+
+	// Выполняет function(shard) для всех частей параллельно. Исключение из параллельного
+	// алгоритма завершило бы программу, поэтому первое из них пробрасывается после обхода
+	template <typename Function>
+	void ForEachShard(Function function) const;
+
+	template <typename ShardRanker>
+	std::vector<Document> FindTopDocumentsImpl(std::string_view raw_query, size_t max_count, ShardRanker ranker) const;
+};
+
+template <typename Function>
+void ShardedSearchServer::ForEachShard(Function function) const {
+	std::vector<size_t> shard_indexes(shards_.size());
+	std::iota(shard_indexes.begin(), shard_indexes.end(), 0);
+	std::vector<std::exception_ptr> errors(shards_.size());
+	std::for_each(std::execution::par, shard_indexes.begin(), shard_indexes.end(), [&](size_t shard) {
+		try {
+			function(shard);
+		} catch (...) {
+			errors[shard] = std::current_exception();
+		}
+	});
+	for (const std::exception_ptr& error : errors) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+}
+
+template <typename ShardRanker>
+std::vector<Document> ShardedSearchServer::FindTopDocumentsImpl(std::string_view raw_query, size_t max_count,
+	ShardRanker ranker) const {
+	const std::vector<PreparedQuery> queries = PrepareQuery(raw_query);
+	std::vector<std::vector<Document>> shard_documents(shards_.size());
+	ForEachShard([&](size_t shard) {
+		shard_documents[shard] = ranker(shards_[shard], queries[shard], max_count);
+	});
+
+	// В каждой части уже отобраны ее лучшие max_count, общий топ - лучшие из них
+	TopDocuments top_documents(max_count);
+	for (const std::vector<Document>& documents : shard_documents) {
+		for (const Document& document : documents) {
+			top_documents.Add(document);
+		}
+	}
+	return top_documents.Extract();
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+	size_t max_count) const {
+	return FindTopDocumentsImpl(raw_query, max_count,
+		[&document_predicate](const SearchServer& shard, const PreparedQuery& query, size_t max_count) {
+			return shard.FindTopDocuments(query, document_predicate, max_count);
+		});
+}
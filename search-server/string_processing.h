@@ -1,8 +1,15 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 #include <set>
 #include <string>
+#include <string_view>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 // По смыслу он ближе к модулю search_server, чем к модулю document. Куда его лучше перенести?
 
@@ -13,7 +20,71 @@ enum class DocumentStatus {
 	REMOVED,
 };
 
-//std::vector<std::string> SplitIntoWords(const std::string& text);
+// Управляющие символы (коды 0-31) недопустимы в словах документов и запросов
+inline bool IsInvalidWordChar(char c) {
+	return c >= '\0' && c < ' ';
+}
+
+// Битовые маски пробелов и недопустимых символов для участка текста длиной до WORD_SCAN_WIDTH байт.
+// Бит i соответствует символу data[i]
+struct WordScanMasks {
+	uint32_t spaces;
+	uint32_t invalid;
+};
+
+constexpr size_t WORD_SCAN_WIDTH = 16;
+
+inline WordScanMasks ScanWordChars(const char* data, size_t size) {
+#ifdef __SSE2__
+	if (size == WORD_SCAN_WIDTH) {
+		const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+		const __m128i spaces = _mm_cmpeq_epi8(chars, _mm_set1_epi8(' '));
+		const __m128i invalid = _mm_and_si128(_mm_cmplt_epi8(chars, _mm_set1_epi8(' ')),
+			_mm_cmpgt_epi8(chars, _mm_set1_epi8(-1)));
+		return {static_cast<uint32_t>(_mm_movemask_epi8(spaces)), static_cast<uint32_t>(_mm_movemask_epi8(invalid))};
+	}
+#endif
+	WordScanMasks masks = {0, 0};
+	for (size_t i = 0; i < size; ++i) {
+		masks.spaces |= static_cast<uint32_t>(data[i] == ' ') << i;
+		masks.invalid |= static_cast<uint32_t>(IsInvalidWordChar(data[i])) << i;
+	}
+	return masks;
+}
+
+// Разбор текста на слова за один проход без выделения памяти. Для каждого непустого слова
+// вызывается callback(word, is_valid); is_valid == false, если в слове есть управляющий символ.
+// Пробелы и недопустимые символы ищутся сразу в WORD_SCAN_WIDTH байтах, если доступен SSE2
+template <typename Callback>
+void ForEachWord(std::string_view text, Callback&& callback) {
+	size_t word_begin = 0;
+	bool is_word_valid = true;
+	for (size_t base = 0; base < text.size(); base += WORD_SCAN_WIDTH) {
+		const size_t size = std::min(WORD_SCAN_WIDTH, text.size() - base);
+		const WordScanMasks masks = ScanWordChars(text.data() + base, size);
+		uint32_t spaces = masks.spaces;
+		// Недопустимые символы до очередного пробела относятся к текущему слову
+		uint32_t invalid = masks.invalid;
+		while (spaces != 0) {
+			const uint32_t space = static_cast<uint32_t>(__builtin_ctz(spaces));
+			const uint32_t before_space = (1u << space) - 1;
+			is_word_valid = is_word_valid && (invalid & before_space) == 0;
+			invalid &= ~before_space;
+			if (base + space > word_begin) {
+				callback(text.substr(word_begin, base + space - word_begin), is_word_valid);
+			}
+			word_begin = base + space + 1;
+			is_word_valid = true;
+			spaces &= spaces - 1;
+		}
+		is_word_valid = is_word_valid && invalid == 0;
+	}
+	if (text.size() > word_begin) {
+		callback(text.substr(word_begin), is_word_valid);
+	}
+}
+
+// Непустые слова текста
 std::vector<std::string_view> SplitIntoWords(std::string_view str);
 
 template <typename StringContainer>
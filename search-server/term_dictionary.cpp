@@ -0,0 +1,50 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+
+using namespace std;
+
+TermDictionary::TermDictionary(const TermDictionary& other)
+	: chunks_(other.chunks_)
+	, chunk_used_(CHUNK_SIZE)
+	, term_to_id_(other.term_to_id_)
+	, terms_(other.terms_) {
+}
+
+TermId TermDictionary::Intern(string_view term) {
+	const auto it = term_to_id_.find(term);
+	if (it != term_to_id_.end()) {
+		return it->second;
+	}
+	const TermId id = static_cast<TermId>(terms_.size());
+	const string_view stored = Store(term);
+	terms_.push_back(stored);
+	term_to_id_.emplace(stored, id);
+	return id;
+}
+
+TermId TermDictionary::Find(string_view term) const {
+	const auto it = term_to_id_.find(term);
+	return it == term_to_id_.end() ? NO_TERM : it->second;
+}
+
+string_view TermDictionary::GetTerm(TermId term) const {
+	return terms_[term];
+}
+
+string_view TermDictionary::Store(string_view term) {
+	if (term.size() > CHUNK_SIZE) {
+		chunks_.emplace_back(new char[term.size()]);
+		copy(term.begin(), term.end(), chunks_.back().get());
+		chunk_used_ = CHUNK_SIZE;
+		return {chunks_.back().get(), term.size()};
+	}
+	if (chunk_used_ + term.size() > CHUNK_SIZE) {
+		chunks_.emplace_back(new char[CHUNK_SIZE]);
+		chunk_used_ = 0;
+	}
+	char* data = chunks_.back().get() + chunk_used_;
+	copy(term.begin(), term.end(), data);
+	chunk_used_ += term.size();
+	return {data, term.size()};
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using TermId = uint32_t;
+
+// Словарь термов: каждому слову один раз выдается целочисленный id.
+// Строки хранятся в общем пуле блоков, поэтому string_view на них не инвалидируются.
+class TermDictionary {
+public:
+	static constexpr TermId NO_TERM = std::numeric_limits<TermId>::max();
+
+	TermDictionary() = default;
+	// Копия разделяет с оригиналом уже записанные блоки строк: они не меняются,
+	// а новые слова копия пишет в собственный блок
+	TermDictionary(const TermDictionary& other);
+	TermDictionary(TermDictionary&&) = default;
+	TermDictionary& operator=(TermDictionary&&) = default;
+
+	TermId Intern(std::string_view term);
+	TermId Find(std::string_view term) const;
+	std::string_view GetTerm(TermId term) const;
+
+	size_t size() const {
+		return terms_.size();
+	}
+
+private:
+	static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+	std::string_view Store(std::string_view term);
+
+	std::vector<std::shared_ptr<char[]>> chunks_;
+	size_t chunk_used_ = CHUNK_SIZE;
+	std::unordered_map<std::string_view, TermId> term_to_id_;
+	std::vector<std::string_view> terms_;
+};
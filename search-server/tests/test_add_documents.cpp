@@ -0,0 +1,101 @@
+#include "search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void AssertSameServers(const SearchServer& search_server, const SearchServer& expected, const TestCorpus& corpus) {
+	ASSERT_EQUAL(search_server.GetDocumentCount(), expected.GetDocumentCount());
+	for (const string& query : corpus.queries) {
+		ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(query), expected.FindTopDocuments(query), query);
+		ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(query, DocumentStatus::BANNED),
+			expected.FindTopDocuments(query, DocumentStatus::BANNED), query);
+	}
+	for (const int document_id : expected) {
+		ASSERT(search_server.GetWordFrequencies(document_id) == expected.GetWordFrequencies(document_id));
+	}
+	for (const string& word : corpus.dictionary) {
+		ASSERT_EQUAL_HINT(search_server.GetDocumentFrequency(word), expected.GetDocumentFrequency(word), word);
+	}
+}
+
+// Пакет дает тот же индекс, что и добавление по одному, в том числе поверх
+// уже заполненного сервера и при повторах слов внутри документа
+void TestBatchMatchesOneByOne() {
+	const TestCorpus corpus = MakeCorpus(21, 2000);
+	vector<NewDocument> first_half;
+	vector<NewDocument> second_half;
+	for (int document_id = 0; document_id < 2000; ++document_id) {
+		(document_id < 1000 ? first_half : second_half).push_back(MakeCorpusDocument(corpus, document_id));
+	}
+	for (const PostingFormat format : {PostingFormat::PLAIN, PostingFormat::COMPRESSED}) {
+		SearchServer expected("and in on"s);
+		FillServer(expected, corpus);
+
+		SearchServer sequential("and in on"s);
+		sequential.SetPostingFormat(format);
+		sequential.AddDocuments(execution::seq, first_half);
+		sequential.AddDocuments(execution::seq, second_half);
+		AssertSameServers(sequential, expected, corpus);
+
+		SearchServer parallel("and in on"s);
+		parallel.SetPostingFormat(format);
+		for (int document_id = 0; document_id < 1000; ++document_id) {
+			AddCorpusDocument(parallel, corpus, document_id);
+		}
+		parallel.AddDocuments(execution::par, second_half);
+		AssertSameServers(parallel, expected, corpus);
+	}
+
+	SearchServer search_server("and"s);
+	search_server.AddDocuments({{1, "cat cat dog"sv, DocumentStatus::ACTUAL, {1, 2}}, {2, "dog"sv, DocumentStatus::BANNED, {}}});
+	ASSERT(abs(search_server.GetWordFrequencies(1).at("cat"sv) - 2.0 / 3.0) < 1e-12);
+	ASSERT_EQUAL(search_server.FindTopDocuments("dog"s, DocumentStatus::BANNED).at(0).rating, 0);
+}
+
+// Ошибка в любом документе пакета отвергает весь пакет: сервер остается прежним
+void TestInvalidBatchChangesNothing() {
+	const TestCorpus corpus = MakeCorpus(22, 300);
+	SearchServer search_server("and"s);
+	SearchServer expected("and"s);
+	for (int document_id = 0; document_id < 100; ++document_id) {
+		AddCorpusDocument(search_server, corpus, document_id);
+		AddCorpusDocument(expected, corpus, document_id);
+	}
+	const uint64_t generation = search_server.GetGeneration();
+	const auto make_batch = [&corpus](NewDocument bad_document) {
+		vector<NewDocument> batch;
+		for (int document_id = 100; document_id < 200; ++document_id) {
+			batch.push_back(MakeCorpusDocument(corpus, document_id));
+		}
+		batch.insert(batch.begin() + 50, move(bad_document));
+		return batch;
+	};
+	const vector<vector<NewDocument>> bad_batches = {
+		make_batch({5, "cat"sv, DocumentStatus::ACTUAL, {}}),
+		make_batch({150, "cat"sv, DocumentStatus::ACTUAL, {}}),
+		make_batch({-1, "cat"sv, DocumentStatus::ACTUAL, {}}),
+		make_batch({500, "cat d\x12og"sv, DocumentStatus::ACTUAL, {}}),
+	};
+	for (const auto& batch : bad_batches) {
+		ASSERT_THROWS(search_server.AddDocuments(execution::seq, batch), invalid_argument);
+		ASSERT_THROWS(search_server.AddDocuments(execution::par, batch), invalid_argument);
+	}
+	ASSERT_EQUAL(search_server.GetGeneration(), generation);
+	AssertSameServers(search_server, expected, corpus);
+	ASSERT_EQUAL(search_server.GetDocumentFrequency("d\x12og"s), 0);
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestBatchMatchesOneByOne);
+	RUN_TEST(TestInvalidBatchChangesNothing);
+}
@@ -0,0 +1,83 @@
+#include "async_search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Запросы из нескольких потоков при разных размерах пакета и числе пакетов в работе
+// получают те же ответы, что и последовательный FindTopDocuments
+void TestConcurrentSubmittersMatchSequential() {
+	const TestCorpus corpus = MakeCorpus(101, 3000, 60);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	const DocumentFilter banned = DocumentFilter().SetStatuses({DocumentStatus::BANNED});
+	const DocumentFilter rated = DocumentFilter().SetRatingRange(100, 2000);
+
+	ThreadPool pool(3);
+	for (const size_t max_batch_size : {1, 8, 64}) {
+		for (const size_t max_batches_in_flight : {1, 2, 0}) {
+			AsyncSearchServer async_server(search_server, pool, chrono::microseconds(100), max_batch_size, max_batches_in_flight);
+			vector<thread> submitters;
+			for (int submitter = 0; submitter < 4; ++submitter) {
+				submitters.emplace_back([&, submitter] {
+					vector<future<vector<Document>>> results;
+					for (const string& query : corpus.queries) {
+						results.push_back(async_server.SubmitQuery(query));
+						results.push_back(async_server.SubmitQuery(query, banned, 2));
+						results.push_back(async_server.SubmitQuery(query, rated));
+					}
+					for (size_t i = 0; i < corpus.queries.size(); ++i) {
+						// Потоки забирают результаты в разном порядке
+						const size_t j = (i + submitter) % corpus.queries.size();
+						const string& query = corpus.queries[j];
+						ASSERT_SAME_DOCUMENTS_HINT(results[3 * j].get(), search_server.FindTopDocuments(query), query);
+						ASSERT_SAME_DOCUMENTS_HINT(results[3 * j + 1].get(), search_server.FindTopDocuments(query, banned, 2), query);
+						ASSERT_SAME_DOCUMENTS_HINT(results[3 * j + 2].get(), search_server.FindTopDocuments(query, rated), query);
+					}
+				});
+			}
+			for (thread& submitter : submitters) {
+				submitter.join();
+			}
+		}
+	}
+}
+
+// Ошибка запроса приходит только в его future, а деструктор дожидается всех принятых запросов
+void TestErrorsAndShutdown() {
+	SearchServer search_server("and"s);
+	search_server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+	vector<future<vector<Document>>> results;
+	future<vector<Document>> invalid;
+	{
+		ThreadPool pool(2);
+		AsyncSearchServer async_server(search_server, pool, chrono::milliseconds(5), 4);
+		invalid = async_server.SubmitQuery("cat --dog"s);
+		for (int i = 0; i < 100; ++i) {
+			results.push_back(async_server.SubmitQuery(i % 2 == 0 ? "cat"s : "bird"s));
+		}
+	}
+	ASSERT_THROWS(invalid.get(), invalid_argument);
+	for (size_t i = 0; i < results.size(); ++i) {
+		ASSERT(results[i].wait_for(chrono::seconds(0)) == future_status::ready);
+		ASSERT_EQUAL(results[i].get().size(), i % 2 == 0 ? 1u : 0u);
+	}
+
+	AsyncSearchServer default_pool_server(search_server);
+	ASSERT_EQUAL(default_pool_server.SubmitQuery("dog"s).get().at(0).id, 1);
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestConcurrentSubmittersMatchSequential);
+	RUN_TEST(TestErrorsAndShutdown);
+}
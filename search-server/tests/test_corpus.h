@@ -0,0 +1,61 @@
+#pragma once
+
+#include "search_server.h"
+#include "generators.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+// Сгенерированный корпус для сравнения путей поиска. Рейтинг документа равен его id:
+// при равной релевантности порядок документов однозначен, и результаты можно сравнивать целиком
+struct TestCorpus {
+	std::vector<std::string> dictionary;
+	std::vector<std::string> documents;
+	std::vector<std::string> queries;
+};
+
+inline TestCorpus MakeCorpus(unsigned seed, int document_count, int query_count = 30, double minus_prob = 0.2) {
+	std::mt19937 generator(seed);
+	TestCorpus corpus;
+	corpus.dictionary = GenerateDictionary(generator, 300, 6);
+	corpus.documents = GenerateQueries(generator, corpus.dictionary, document_count, 20);
+	corpus.queries = GenerateQueries(generator, corpus.dictionary, query_count, 6, minus_prob);
+	return corpus;
+}
+
+// Корпус из частых слов, в котором слово rare встречается только в каждом spacing-м документе:
+// его вхождения разделены участками индексов без вхождений
+inline TestCorpus MakeRareTermCorpus(int document_count, int spacing) {
+	TestCorpus corpus;
+	for (int i = 0; i < document_count; ++i) {
+		std::string document = "common filler w" + std::to_string(i % 50);
+		if (i % spacing == 0) {
+			document += " rare";
+		}
+		corpus.documents.push_back(std::move(document));
+	}
+	corpus.queries = {"rare", "rare -w0", "rare w3 w7", "rare common"};
+	return corpus;
+}
+
+inline DocumentStatus GetCorpusStatus(int document_id) {
+	return static_cast<DocumentStatus>(document_id % 4);
+}
+
+inline NewDocument MakeCorpusDocument(const TestCorpus& corpus, int document_id) {
+	return {document_id, corpus.documents[document_id % corpus.documents.size()], GetCorpusStatus(document_id), {document_id}};
+}
+
+template <typename Server>
+void AddCorpusDocument(Server& search_server, const TestCorpus& corpus, int document_id) {
+	const NewDocument document = MakeCorpusDocument(corpus, document_id);
+	search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+}
+
+template <typename Server>
+void FillServer(Server& search_server, const TestCorpus& corpus) {
+	for (size_t i = 0; i < corpus.documents.size(); ++i) {
+		AddCorpusDocument(search_server, corpus, static_cast<int>(i));
+	}
+}
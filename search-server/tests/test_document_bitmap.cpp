@@ -0,0 +1,64 @@
+#include "document_bitmap.h"
+#include "search_server.h"
+#include "test_framework.h"
+
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Разреженные контейнеры (массив) и плотные (битовая карта) отвечают так же, как std::set
+void TestContainsMatchesSet() {
+	mt19937 generator(41);
+	vector<uint32_t> document_indexes;
+	// Плотный диапазон в первом контейнере, разреженные значения в остальных, повторы
+	for (uint32_t i = 0; i < 10000; ++i) {
+		document_indexes.push_back(generator() % 30000);
+	}
+	for (uint32_t i = 0; i < 100; ++i) {
+		document_indexes.push_back(65536 * 3 + generator() % 65536);
+	}
+	document_indexes.push_back(~0u);
+	document_indexes.push_back(document_indexes.front());
+	const set<uint32_t> expected(document_indexes.begin(), document_indexes.end());
+	const DocumentBitmap bitmap(document_indexes);
+	ASSERT_EQUAL(bitmap.size(), expected.size());
+	for (uint32_t document_index = 0; document_index < 65536 * 5; ++document_index) {
+		ASSERT_EQUAL(bitmap.Contains(document_index), expected.count(document_index) > 0);
+	}
+	ASSERT(bitmap.Contains(~0u));
+	ASSERT(!bitmap.Contains(~0u - 1));
+	ASSERT(DocumentBitmap().empty());
+	ASSERT(!DocumentBitmap().Contains(0));
+}
+
+// Документы с минус-словом исключаются во всех путях, даже если плюс-слова у них частые
+void TestMinusWordsExcludeDocuments() {
+	SearchServer search_server("and"s);
+	for (int document_id = 0; document_id < 3000; ++document_id) {
+		const string text = "common word"s + to_string(document_id % 10) + (document_id % 7 == 0 ? " ad"s : ""s);
+		search_server.AddDocument(document_id, text, DocumentStatus::ACTUAL, {document_id});
+	}
+	const auto check = [](const vector<Document>& documents) {
+		ASSERT_EQUAL(documents.size(), 5u);
+		for (const Document& document : documents) {
+			ASSERT(document.id % 7 != 0);
+		}
+	};
+	check(search_server.FindTopDocuments("common word3 -ad"s));
+	check(search_server.FindTopDocuments(execution::par, "common word3 -ad"s));
+	search_server.SetRankingMode(RankingMode::MAX_SCORE);
+	check(search_server.FindTopDocuments("common word3 -ad"s));
+	ASSERT(search_server.FindTopDocuments("ad -ad"s).empty());
+	ASSERT(get<0>(search_server.MatchDocument("common -ad"s, 7)).empty());
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestContainsMatchesSet);
+	RUN_TEST(TestMinusWordsExcludeDocuments);
+}
@@ -0,0 +1,60 @@
+#include "document_filter.h"
+#include "search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void TestMatches() {
+	const DocumentFilter any;
+	ASSERT(any.Matches(DocumentStatus::REMOVED, -100));
+	const DocumentFilter filter = DocumentFilter().SetStatuses({DocumentStatus::ACTUAL, DocumentStatus::BANNED}).SetRatingRange(-1, 3);
+	ASSERT(filter.Matches(DocumentStatus::ACTUAL, -1));
+	ASSERT(filter.Matches(DocumentStatus::BANNED, 3));
+	ASSERT(!filter.Matches(DocumentStatus::IRRELEVANT, 0));
+	ASSERT(!filter.Matches(DocumentStatus::ACTUAL, 4));
+	ASSERT(!DocumentFilter().SetStatuses({}).Matches(DocumentStatus::ACTUAL, 0));
+}
+
+// Фильтр проверяется битовой маской по всем документам для широких запросов
+// и по столбцам на каждое вхождение для узких; оба пути совпадают с лямбдой
+void TestFilterMatchesLambda() {
+	const TestCorpus corpus = MakeCorpus(31, 4000);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	vector<string> queries = corpus.queries;
+	// Одно слово из словаря - узкий запрос, для которого маска не строится
+	for (size_t i = 0; i < 10; ++i) {
+		queries.push_back(corpus.dictionary[i * 7 + 1]);
+	}
+	const vector<DocumentFilter> filters = {
+		DocumentFilter(),
+		DocumentFilter().SetStatuses({DocumentStatus::BANNED}),
+		DocumentFilter().SetRatingRange(1000, 2500),
+		DocumentFilter().SetStatuses({DocumentStatus::ACTUAL, DocumentStatus::REMOVED}).SetRatingRange(0, 1999),
+	};
+	for (const DocumentFilter& filter : filters) {
+		const auto lambda = [&filter](int, DocumentStatus status, int rating) {
+			return filter.Matches(status, rating);
+		};
+		for (const string& query : queries) {
+			const auto expected = search_server.FindTopDocuments(query, lambda, 10);
+			ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(query, filter, 10), expected, query);
+			ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(execution::par, query, filter, 10), expected, query);
+			QueryContext context;
+			ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(context, query, filter, 10), expected, query);
+		}
+	}
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestMatches);
+	RUN_TEST(TestFilterMatchesLambda);
+}
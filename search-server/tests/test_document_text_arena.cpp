@@ -0,0 +1,73 @@
+#include "document_text_arena.h"
+#include "test_framework.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Сохраненные тексты не двигаются при дальнейших добавлениях и удалениях
+void TestStoredTextsStayInPlace() {
+	DocumentTextArena arena;
+	vector<string> originals;
+	vector<string_view> stored;
+	for (int i = 0; i < 20000; ++i) {
+		originals.push_back("document "s + to_string(i) + string(i % 300, 'x'));
+		stored.push_back(arena.Store(originals.back()));
+	}
+	for (size_t i = 0; i < originals.size(); i += 2) {
+		arena.Release(stored[i]);
+	}
+	for (int i = 0; i < 5000; ++i) {
+		arena.Store("new text "s + to_string(i));
+	}
+	for (size_t i = 1; i < originals.size(); i += 2) {
+		ASSERT_EQUAL(stored[i], originals[i]);
+	}
+	ASSERT(arena.Store(""sv).empty());
+	const string large(3 * 1024 * 1024, 'y');
+	ASSERT_EQUAL(arena.Store(large), large);
+}
+
+void TestByteAccounting() {
+	DocumentTextArena arena;
+	const string_view first = arena.Store("first"sv);
+	const string_view second = arena.Store("second"sv);
+	ASSERT_EQUAL(arena.GetLiveBytes(), 11u);
+	ASSERT_EQUAL(arena.GetFreeBytes(), 0u);
+	arena.Release(first);
+	ASSERT_EQUAL(arena.GetLiveBytes(), 6u);
+	ASSERT_EQUAL(arena.GetFreeBytes(), 5u);
+	// Опустевший блок больше не числится занятым
+	arena.Release(second);
+	ASSERT_EQUAL(arena.GetLiveBytes(), 0u);
+	ASSERT_EQUAL(arena.GetFreeBytes(), 0u);
+	ASSERT_EQUAL(arena.Store("third"sv), "third"sv);
+}
+
+// Копия разделяет блоки: ни удаления, ни новые тексты одной стороны не портят другую
+void TestCopySharesChunks() {
+	DocumentTextArena arena;
+	const string_view kept = arena.Store("kept"sv);
+	const string_view released = arena.Store("released"sv);
+	DocumentTextArena copy(arena);
+	arena.Release(kept);
+	arena.Release(released);
+	const string_view original_text = arena.Store("original side"sv);
+	const string_view copy_text = copy.Store("copy side"sv);
+	ASSERT_EQUAL(kept, "kept"sv);
+	ASSERT_EQUAL(released, "released"sv);
+	ASSERT_EQUAL(original_text, "original side"sv);
+	ASSERT_EQUAL(copy_text, "copy side"sv);
+	ASSERT_EQUAL(copy.GetLiveBytes(), 12u + 9u);
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestStoredTextsStayInPlace);
+	RUN_TEST(TestByteAccounting);
+	RUN_TEST(TestCopySharesChunks);
+}
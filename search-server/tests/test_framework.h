@@ -0,0 +1,98 @@
+#pragma once
+
+#include "document.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Минимальный набор проверок для тестов сервера: при ошибке печатается место и выражение,
+// и программа завершается аварийно
+
+template <typename T, typename U>
+void AssertEqualImpl(const T& t, const U& u, const std::string& t_str, const std::string& u_str,
+		const std::string& file, const std::string& func, unsigned line, const std::string& hint) {
+	if (t != u) {
+		std::cerr << std::boolalpha;
+		std::cerr << file << "("s << line << "): "s << func << ": "s;
+		std::cerr << "ASSERT_EQUAL("s << t_str << ", "s << u_str << ") failed: "s;
+		std::cerr << t << " != "s << u << "."s;
+		if (!hint.empty()) {
+			std::cerr << " Hint: "s << hint;
+		}
+		std::cerr << std::endl;
+		std::abort();
+	}
+}
+
+#define ASSERT_EQUAL(a, b) AssertEqualImpl((a), (b), #a, #b, __FILE__, __FUNCTION__, __LINE__, ""s)
+#define ASSERT_EQUAL_HINT(a, b, hint) AssertEqualImpl((a), (b), #a, #b, __FILE__, __FUNCTION__, __LINE__, (hint))
+
+inline void AssertImpl(bool value, const std::string& expr_str, const std::string& file, const std::string& func,
+		unsigned line, const std::string& hint) {
+	if (!value) {
+		std::cerr << file << "("s << line << "): "s << func << ": "s;
+		std::cerr << "ASSERT("s << expr_str << ") failed."s;
+		if (!hint.empty()) {
+			std::cerr << " Hint: "s << hint;
+		}
+		std::cerr << std::endl;
+		std::abort();
+	}
+}
+
+#define ASSERT(expr) AssertImpl(!!(expr), #expr, __FILE__, __FUNCTION__, __LINE__, ""s)
+#define ASSERT_HINT(expr, hint) AssertImpl(!!(expr), #expr, __FILE__, __FUNCTION__, __LINE__, (hint))
+
+#define ASSERT_THROWS(expr, exception_type)                                              \
+	do {                                                                                 \
+		bool is_thrown = false;                                                          \
+		try {                                                                            \
+			expr;                                                                        \
+		} catch (const exception_type&) {                                                \
+			is_thrown = true;                                                            \
+		}                                                                                \
+		AssertImpl(is_thrown, #expr " throws " #exception_type, __FILE__, __FUNCTION__, __LINE__, ""s); \
+	} while (false)
+
+// Результаты разных путей поиска должны совпадать с последовательным FindTopDocuments:
+// те же документы в том же порядке, релевантность - с точностью до округления
+inline void AssertSameDocumentsImpl(const std::vector<Document>& actual, const std::vector<Document>& expected,
+		const std::string& file, const std::string& func, unsigned line, const std::string& hint) {
+	bool is_same = actual.size() == expected.size();
+	for (size_t i = 0; is_same && i < actual.size(); ++i) {
+		is_same = actual[i].id == expected[i].id && actual[i].rating == expected[i].rating
+			&& std::abs(actual[i].relevance - expected[i].relevance) < 1e-9;
+	}
+	if (!is_same) {
+		std::cerr << file << "("s << line << "): "s << func << ": documents differ."s;
+		if (!hint.empty()) {
+			std::cerr << " Hint: "s << hint;
+		}
+		std::cerr << std::endl << "  actual:  "s;
+		for (const Document& document : actual) {
+			std::cerr << document << ' ';
+		}
+		std::cerr << std::endl << "  expected: "s;
+		for (const Document& document : expected) {
+			std::cerr << document << ' ';
+		}
+		std::cerr << std::endl;
+		std::abort();
+	}
+}
+
+#define ASSERT_SAME_DOCUMENTS(actual, expected) \
+	AssertSameDocumentsImpl((actual), (expected), __FILE__, __FUNCTION__, __LINE__, ""s)
+#define ASSERT_SAME_DOCUMENTS_HINT(actual, expected, hint) \
+	AssertSameDocumentsImpl((actual), (expected), __FILE__, __FUNCTION__, __LINE__, (hint))
+
+template <typename TestFunc>
+void RunTestImpl(const TestFunc& func, const std::string& test_name) {
+	func();
+	std::cerr << test_name << " OK"s << std::endl;
+}
+
+#define RUN_TEST(func) RunTestImpl((func), #func)
@@ -0,0 +1,62 @@
+#include "search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Пакетное сопоставление совпадает с MatchDocument по каждому id в любом порядке id,
+// с повторами и в обоих форматах списков
+void TestMatchesOneByOne() {
+	const TestCorpus corpus = MakeCorpus(51, 3000);
+	mt19937 generator(52);
+	for (const PostingFormat format : {PostingFormat::PLAIN, PostingFormat::COMPRESSED}) {
+		SearchServer search_server("and"s);
+		search_server.SetPostingFormat(format);
+		FillServer(search_server, corpus);
+		for (int document_id = 0; document_id < 3000; document_id += 3) {
+			search_server.RemoveDocument(document_id);
+		}
+		vector<int> document_ids(search_server.begin(), search_server.end());
+		shuffle(document_ids.begin(), document_ids.end(), generator);
+		document_ids.resize(700);
+		document_ids.push_back(document_ids.front());
+		for (const string& query : corpus.queries) {
+			const auto sequential = search_server.MatchDocuments(query, document_ids);
+			const auto parallel = search_server.MatchDocuments(execution::par, query, document_ids);
+			ASSERT_EQUAL_HINT(sequential.size(), document_ids.size(), query);
+			for (size_t i = 0; i < document_ids.size(); ++i) {
+				const auto expected = search_server.MatchDocument(query, document_ids[i]);
+				ASSERT_HINT(sequential[i] == expected, query);
+				ASSERT_HINT(parallel[i] == expected, query);
+			}
+		}
+	}
+}
+
+void TestErrors() {
+	SearchServer search_server("and"s);
+	search_server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+	search_server.AddDocument(2, "cat bird"s, DocumentStatus::BANNED, {2});
+	ASSERT(search_server.MatchDocuments("cat"s, {}).empty());
+	const auto result = search_server.MatchDocuments("cat -bird"s, {2, 1});
+	ASSERT(get<0>(result[0]).empty());
+	ASSERT(get<1>(result[0]) == DocumentStatus::BANNED);
+	ASSERT_EQUAL(get<0>(result[1]).size(), 1u);
+	ASSERT_THROWS(search_server.MatchDocuments("cat"s, {1, 3}), out_of_range);
+	ASSERT_THROWS(search_server.MatchDocuments(execution::par, "cat"s, {3}), out_of_range);
+	ASSERT_THROWS(search_server.MatchDocuments("cat --dog"s, {1}), invalid_argument);
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestMatchesOneByOne);
+	RUN_TEST(TestErrors);
+}
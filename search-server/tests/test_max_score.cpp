@@ -0,0 +1,99 @@
+#include "search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// MaxScore отсекает документы, которые по верхней оценке не войдут в топ,
+// поэтому результат должен совпадать с полным подсчетом при любом K и фильтре
+void CheckSameAsExhaustive(SearchServer& search_server, const TestCorpus& corpus) {
+	const auto is_odd = [](int document_id, DocumentStatus, int) {
+		return document_id % 2 == 1;
+	};
+	for (const string& query : corpus.queries) {
+		for (const size_t max_count : {1u, 5u, 40u}) {
+			search_server.SetRankingMode(RankingMode::EXHAUSTIVE);
+			const auto expected = search_server.FindTopDocuments(query, DocumentFilter(), max_count);
+			const auto expected_odd = search_server.FindTopDocuments(query, is_odd, max_count);
+			const auto expected_banned = search_server.FindTopDocuments(query, DocumentStatus::BANNED, max_count);
+			search_server.SetRankingMode(RankingMode::MAX_SCORE);
+			ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(query, DocumentFilter(), max_count), expected, query);
+			ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(query, is_odd, max_count), expected_odd, query);
+			ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(query, DocumentStatus::BANNED, max_count),
+				expected_banned, query);
+		}
+	}
+}
+
+void TestShortQueries() {
+	const TestCorpus corpus = MakeCorpus(11, 5000);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	CheckSameAsExhaustive(search_server, corpus);
+}
+
+// Длинные запросы, как в main.cpp: здесь необязательных слов больше всего
+void TestLongQueries() {
+	TestCorpus corpus = MakeCorpus(12, 5000);
+	mt19937 generator(13);
+	corpus.queries = GenerateQueries(generator, corpus.dictionary, 10, 70, 0.1);
+	for (const PostingFormat format : {PostingFormat::PLAIN, PostingFormat::COMPRESSED}) {
+		SearchServer search_server("and"s);
+		search_server.SetPostingFormat(format);
+		FillServer(search_server, corpus);
+		CheckSameAsExhaustive(search_server, corpus);
+	}
+}
+
+// Редкое слово на большом индексе: окна начинаются с его вхождений и пропускают участки без них
+void TestRareTermOnLargeIndex() {
+	const TestCorpus corpus = MakeRareTermCorpus(100000, 10007);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	CheckSameAsExhaustive(search_server, corpus);
+}
+
+// Верхние оценки слов после удаления документов могут только завышать максимум
+void TestAfterRemoval() {
+	const TestCorpus corpus = MakeCorpus(14, 3000);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	for (int document_id = 0; document_id < 3000; document_id += 3) {
+		search_server.RemoveDocument(document_id);
+	}
+	CheckSameAsExhaustive(search_server, corpus);
+}
+
+// Предикат проверяется до подсчета релевантности, один раз на документ: отброшенные
+// документы и документы с минус-словами не считаются по остальным словам запроса
+void TestPredicateCheckedOncePerDocument() {
+	const TestCorpus corpus = MakeCorpus(15, 3000);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	search_server.SetRankingMode(RankingMode::MAX_SCORE);
+	for (const string& query : corpus.queries) {
+		map<int, int> call_counts;
+		search_server.FindTopDocuments(query, [&call_counts](int document_id, DocumentStatus, int) {
+			return ++call_counts[document_id] == 1 && document_id % 3 != 0;
+		});
+		for (const auto [document_id, call_count] : call_counts) {
+			ASSERT_EQUAL_HINT(call_count, 1, query);
+		}
+	}
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestShortQueries);
+	RUN_TEST(TestLongQueries);
+	RUN_TEST(TestRareTermOnLargeIndex);
+	RUN_TEST(TestAfterRemoval);
+	RUN_TEST(TestPredicateCheckedOncePerDocument);
+}
@@ -0,0 +1,57 @@
+#include "search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <execution>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Параллельный путь делит документы на отрезки; отрезков должно быть несколько,
+// поэтому документов больше, чем MIN_PARALLEL_CHUNK_SIZE на каждый
+void TestParallelMatchesSequential() {
+	const TestCorpus corpus = MakeCorpus(21, 6000);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	const auto is_even = [](int document_id, DocumentStatus, int) {
+		return document_id % 2 == 0;
+	};
+	const DocumentFilter filter = DocumentFilter().SetStatuses({DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT})
+		.SetRatingRange(100, 4000);
+	for (const string& query : corpus.queries) {
+		ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(execution::par, query),
+			search_server.FindTopDocuments(query), query);
+		ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(execution::seq, query),
+			search_server.FindTopDocuments(query), query);
+		ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(execution::par, query, is_even),
+			search_server.FindTopDocuments(query, is_even), query);
+		ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(execution::par, query, filter, 20),
+			search_server.FindTopDocuments(query, filter, 20), query);
+		ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(execution::par, query, DocumentStatus::REMOVED),
+			search_server.FindTopDocuments(query, DocumentStatus::REMOVED), query);
+	}
+}
+
+void TestParallelMatchDocument() {
+	const TestCorpus corpus = MakeCorpus(22, 200);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	for (const string& query : corpus.queries) {
+		for (int document_id = 0; document_id < 200; document_id += 7) {
+			auto [words, status] = search_server.MatchDocument(query, document_id);
+			auto [par_words, par_status] = search_server.MatchDocument(execution::par, query, document_id);
+			ASSERT(words == par_words);
+			ASSERT(status == par_status);
+		}
+	}
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestParallelMatchesSequential);
+	RUN_TEST(TestParallelMatchDocument);
+}
@@ -0,0 +1,182 @@
+#include "posting_list.h"
+#include "test_framework.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+vector<Posting> MakePostings(mt19937& generator, size_t count, uint32_t max_gap) {
+	uniform_int_distribution<uint32_t> gap(1, max_gap);
+	uniform_real_distribution<double> term_freq(0.01, 1.0);
+	vector<Posting> postings;
+	uint32_t document_index = gap(generator) - 1;
+	for (size_t i = 0; i < count; ++i) {
+		postings.push_back({document_index, term_freq(generator)});
+		document_index += gap(generator);
+	}
+	return postings;
+}
+
+vector<Posting> ToVector(const PostingList& list) {
+	vector<Posting> postings;
+	for (const Posting posting : list) {
+		postings.push_back(posting);
+	}
+	return postings;
+}
+
+void AssertSamePostings(const vector<Posting>& lhs, const vector<Posting>& rhs, const string& hint) {
+	ASSERT_EQUAL_HINT(lhs.size(), rhs.size(), hint);
+	for (size_t i = 0; i < lhs.size(); ++i) {
+		ASSERT_EQUAL_HINT(lhs[i].document_index, rhs[i].document_index, hint);
+		ASSERT_EQUAL_HINT(lhs[i].term_freq, rhs[i].term_freq, hint);
+	}
+}
+
+// Сжатый список отдает те же вхождения, что и несжатый, на границах блоков
+// и при любой ширине разностей, в том числе после переключения формата
+void TestCompressedMatchesPlain() {
+	mt19937 generator(13);
+	for (const size_t count : {0, 1, 2, 127, 128, 129, 256, 1000}) {
+		for (const uint32_t max_gap : {1u, 3u, 1000u, 1u << 24}) {
+			const vector<Posting> expected = MakePostings(generator, count, max_gap);
+			const string hint = to_string(count) + " "s + to_string(max_gap);
+			PostingList plain;
+			PostingList compressed;
+			compressed.SetCompressed(true);
+			PostingList assigned;
+			assigned.SetCompressed(true);
+			vector<uint32_t> document_indexes;
+			vector<double> term_freqs;
+			for (const Posting& posting : expected) {
+				plain.Add(posting.document_index, posting.term_freq);
+				compressed.Add(posting.document_index, posting.term_freq);
+				document_indexes.push_back(posting.document_index);
+				term_freqs.push_back(posting.term_freq);
+			}
+			assigned.Assign(document_indexes.data(), term_freqs.data(), count);
+			AssertSamePostings(ToVector(plain), expected, hint);
+			AssertSamePostings(ToVector(compressed), expected, hint);
+			AssertSamePostings(ToVector(assigned), expected, hint);
+			ASSERT_EQUAL_HINT(compressed.GetMaxTermFreq(), plain.GetMaxTermFreq(), hint);
+			ASSERT_EQUAL_HINT(assigned.GetMaxTermFreq(), plain.GetMaxTermFreq(), hint);
+			if (count >= 256 && max_gap < 1000) {
+				ASSERT_HINT(compressed.GetMemoryUsage() < plain.GetMemoryUsage(), hint);
+			}
+
+			plain.SetCompressed(true);
+			compressed.SetCompressed(false);
+			AssertSamePostings(ToVector(plain), expected, hint);
+			AssertSamePostings(ToVector(compressed), expected, hint);
+		}
+	}
+}
+
+// Распаковка дает исходные индексы при любой ширине разностей от 1 до 32 бит:
+// наибольшая разность в каждом блоке ровно задает ширину, а ее место в блоке меняется
+void TestEveryBitWidth() {
+	mt19937 generator(15);
+	for (uint32_t bit_width = 1; bit_width <= 32; ++bit_width) {
+		const uint32_t widest_gap = uint32_t{1} << (bit_width - 1);
+		// Индексы должны поместиться в uint32_t вместе с одной широкой разностью на блок
+		uniform_int_distribution<uint32_t> gap(1, min<uint32_t>(widest_gap, 1u << 20));
+		const size_t count = bit_width < 32 ? 3 * PostingList::BLOCK_SIZE + 5 : PostingList::BLOCK_SIZE + 1;
+		vector<uint32_t> document_indexes;
+		vector<double> term_freqs;
+		uint32_t document_index = 0;
+		for (size_t i = 0; i < count; ++i) {
+			const size_t widest_position = 1 + (bit_width * 7 + i / PostingList::BLOCK_SIZE) % (PostingList::BLOCK_SIZE - 1);
+			const bool is_widest = i % PostingList::BLOCK_SIZE == widest_position;
+			document_index += i == 0 ? 0 : (is_widest ? widest_gap : gap(generator));
+			document_indexes.push_back(document_index);
+			term_freqs.push_back(1.0 / (i + 1));
+		}
+		PostingList list;
+		list.SetCompressed(true);
+		list.Assign(document_indexes.data(), term_freqs.data(), count);
+		vector<Posting> expected;
+		for (size_t i = 0; i < count; ++i) {
+			expected.push_back({document_indexes[i], term_freqs[i]});
+		}
+		AssertSamePostings(ToVector(list), expected, to_string(bit_width));
+	}
+}
+
+// Поиск с начала и сдвиг итератора на месте находят то же вхождение, что и линейный проход
+void TestLowerBoundAndSkipTo() {
+	mt19937 generator(14);
+	const vector<Posting> expected = MakePostings(generator, 5000, 20);
+	for (const bool is_compressed : {false, true}) {
+		PostingList list;
+		list.SetCompressed(is_compressed);
+		for (const Posting& posting : expected) {
+			list.Add(posting.document_index, posting.term_freq);
+		}
+		const auto expected_lower_bound = [&expected](uint32_t document_index) {
+			return lower_bound(expected.begin(), expected.end(), document_index, [](const Posting& posting, uint32_t index) {
+				return posting.document_index < index;
+			});
+		};
+		const uint32_t max_index = expected.back().document_index + 10;
+		uniform_int_distribution<uint32_t> target(0, max_index);
+		for (int i = 0; i < 2000; ++i) {
+			const uint32_t document_index = target(generator);
+			const auto expected_it = expected_lower_bound(document_index);
+			const auto it = list.LowerBound(document_index);
+			if (expected_it == expected.end()) {
+				ASSERT(it == list.end());
+			} else {
+				ASSERT(it != list.end());
+				ASSERT_EQUAL(it->document_index, expected_it->document_index);
+				ASSERT_EQUAL(it->term_freq, expected_it->term_freq);
+			}
+		}
+
+		auto it = list.begin();
+		for (uint32_t document_index = 0; document_index <= max_index; document_index += 1 + document_index % 300) {
+			list.SkipTo(it, document_index);
+			const auto expected_it = expected_lower_bound(document_index);
+			if (expected_it == expected.end()) {
+				ASSERT(it == list.end());
+				break;
+			}
+			ASSERT_EQUAL(it->document_index, expected_it->document_index);
+			// Копия итератора не зависит от оригинала
+			auto copy = it;
+			++copy;
+			ASSERT(copy == list.end() || copy->document_index > it->document_index);
+			ASSERT_EQUAL(it->document_index, expected_it->document_index);
+		}
+	}
+}
+
+// Повторное слово документа складывается с последним вхождением и в сжатом режиме
+void TestRepeatedDocumentIsMerged() {
+	for (const bool is_compressed : {false, true}) {
+		PostingList list;
+		list.SetCompressed(is_compressed);
+		for (uint32_t document_index = 0; document_index < 300; ++document_index) {
+			list.Add(document_index, 0.25);
+			list.Add(document_index, 0.25);
+		}
+		ASSERT_EQUAL(list.size(), 300u);
+		for (const Posting posting : list) {
+			ASSERT_EQUAL(posting.term_freq, 0.5);
+		}
+		ASSERT_EQUAL(list.GetMaxTermFreq(), 0.5);
+	}
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestCompressedMatchesPlain);
+	RUN_TEST(TestEveryBitWidth);
+	RUN_TEST(TestLowerBoundAndSkipTo);
+	RUN_TEST(TestRepeatedDocumentIsMerged);
+}
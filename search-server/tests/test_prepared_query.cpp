@@ -0,0 +1,144 @@
+#include "search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <cmath>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+void AssertSameAsText(const SearchServer& search_server, const PreparedQuery& prepared) {
+	const string query(prepared.GetText());
+	ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(prepared), search_server.FindTopDocuments(query), query);
+	ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(prepared, DocumentStatus::BANNED),
+		search_server.FindTopDocuments(query, DocumentStatus::BANNED), query);
+	QueryContext context;
+	ASSERT_SAME_DOCUMENTS_HINT(vector<Document>(search_server.FindTopDocuments(context, prepared)),
+		search_server.FindTopDocuments(query), query);
+	for (const int document_id : search_server) {
+		ASSERT(search_server.MatchDocument(prepared, document_id) == search_server.MatchDocument(query, document_id));
+		break;
+	}
+}
+
+// Подготовленный запрос дает те же ответы, что и текст, и остается верным после изменения индекса
+void TestPreparedMatchesText() {
+	const TestCorpus corpus = MakeCorpus(41, 2000);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	vector<PreparedQuery> prepared;
+	for (const string& query : corpus.queries) {
+		prepared.push_back(search_server.PrepareQuery(query));
+		ASSERT_EQUAL(prepared.back().GetServerId(), search_server.GetInstanceId());
+	}
+	for (const RankingMode mode : {RankingMode::EXHAUSTIVE, RankingMode::MAX_SCORE}) {
+		search_server.SetRankingMode(mode);
+		for (const PreparedQuery& query : prepared) {
+			AssertSameAsText(search_server, query);
+		}
+	}
+	for (int document_id = 0; document_id < 500; ++document_id) {
+		search_server.RemoveDocument(document_id);
+	}
+	for (const PreparedQuery& query : prepared) {
+		AssertSameAsText(search_server, query);
+	}
+}
+
+// Копия и сервер-источник расходятся при одинаковом поколении: запрос, подготовленный
+// одним из них, другой разбирает заново
+void TestCopyGetsNewInstanceId() {
+	SearchServer original("and"s);
+	original.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+	const PreparedQuery prepared = original.PrepareQuery("cat bird"s);
+	SearchServer copy = original;
+	ASSERT(copy.GetInstanceId() != original.GetInstanceId());
+	original.AddDocument(2, "cat fish"s, DocumentStatus::ACTUAL, {2});
+	copy.AddDocument(2, "bird"s, DocumentStatus::ACTUAL, {2});
+	ASSERT_EQUAL(copy.GetGeneration(), original.GetGeneration());
+	ASSERT_EQUAL(copy.FindTopDocuments(prepared).size(), 2u);
+	AssertSameAsText(copy, prepared);
+	AssertSameAsText(original, prepared);
+
+	const uint64_t copy_id = copy.GetInstanceId();
+	SearchServer moved = move(copy);
+	ASSERT(moved.GetInstanceId() != copy_id);
+	AssertSameAsText(moved, prepared);
+}
+
+// Сервер, загруженный из снимка по адресу прежнего, с тем же нулевым поколением,
+// не принимает подготовленный прежним сервером запрос за свой
+void TestLoadedServerAtReusedAddress() {
+	const string path = (filesystem::temp_directory_path() / ("test_prepared_query_"s + to_string(getpid()) + ".bin"s)).string();
+	SearchServer first_source("and"s);
+	first_source.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+	first_source.AddDocument(2, "bird"s, DocumentStatus::ACTUAL, {2});
+	SearchServer second_source("and"s);
+	second_source.AddDocument(1, "bird fish"s, DocumentStatus::ACTUAL, {1});
+	second_source.AddDocument(2, "fish cat"s, DocumentStatus::ACTUAL, {2});
+	second_source.AddDocument(3, "dog"s, DocumentStatus::ACTUAL, {3});
+
+	optional<SearchServer> search_server;
+	first_source.SaveSnapshot(path);
+	search_server.emplace(SearchServer::LoadSnapshot(path));
+	const SearchServer* first_address = &*search_server;
+	const uint64_t first_id = search_server->GetInstanceId();
+	const PreparedQuery prepared = search_server->PrepareQuery("cat -bird"s);
+
+	search_server.reset();
+	second_source.SaveSnapshot(path);
+	search_server.emplace(SearchServer::LoadSnapshot(path));
+	ASSERT(&*search_server == first_address);
+	ASSERT_EQUAL(search_server->GetGeneration(), prepared.GetGeneration());
+	ASSERT(search_server->GetInstanceId() != first_id);
+	AssertSameAsText(*search_server, prepared);
+	ASSERT_EQUAL(search_server->FindTopDocuments(prepared).at(0).id, 2);
+	filesystem::remove(path);
+}
+
+// Запрос с IDF вызывающего считается с ними, а после изменения индекса отклоняется во всех
+// видах поиска, а не пересчитывается молча с местными IDF
+void TestExternalIdfQueryBecomesStale() {
+	SearchServer search_server("and"s);
+	search_server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+	search_server.AddDocument(2, "cat bird bird"s, DocumentStatus::ACTUAL, {2});
+	search_server.AddDocument(3, "fish"s, DocumentStatus::ACTUAL, {3});
+	const auto external_idf = [](string_view word) {
+		return word == "dog"sv ? 1.0 : 10.0;
+	};
+	const PreparedQuery prepared = search_server.PrepareQuery("dog bird"s, external_idf);
+	ASSERT(prepared.HasExternalInverseDocumentFreqs());
+	ASSERT(!search_server.PrepareQuery("dog bird"s).HasExternalInverseDocumentFreqs());
+	const vector<Document> documents = search_server.FindTopDocuments(prepared);
+	ASSERT_EQUAL(documents.size(), 2u);
+	ASSERT_EQUAL(documents[0].id, 2);
+	ASSERT(abs(documents[0].relevance - 10.0 * 2 / 3) < 1e-9);
+	ASSERT(abs(documents[1].relevance - 1.0 / 2) < 1e-9);
+
+	search_server.AddDocument(4, "dog"s, DocumentStatus::ACTUAL, {4});
+	ASSERT_THROWS(search_server.FindTopDocuments(prepared), runtime_error);
+	QueryContext context;
+	ASSERT_THROWS(search_server.FindTopDocuments(context, prepared), runtime_error);
+	ASSERT_THROWS(search_server.MatchDocument(prepared, 1), runtime_error);
+	ASSERT_THROWS(search_server.FindTopDocumentsBatch({{&prepared, DocumentFilter(), 5}}), runtime_error);
+
+	const PreparedQuery refreshed = search_server.PrepareQuery("dog bird"s, external_idf);
+	ASSERT_EQUAL(search_server.FindTopDocuments(refreshed).size(), 3u);
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestPreparedMatchesText);
+	RUN_TEST(TestCopyGetsNewInstanceId);
+	RUN_TEST(TestLoadedServerAtReusedAddress);
+	RUN_TEST(TestExternalIdfQueryBecomesStale);
+}
@@ -0,0 +1,81 @@
+#include "process_queries.h"
+#include "search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Все способы пакетной обработки возвращают то же, что последовательные FindTopDocuments,
+// в том числе когда часть запросов ничего не находит
+void TestBatchesMatchSequential() {
+	const TestCorpus corpus = MakeCorpus(91, 3000, 200);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	vector<string> queries = corpus.queries;
+	queries.push_back("nosuchword"s);
+	queries.insert(queries.begin(), "and"s);
+	vector<vector<Document>> expected;
+	for (const string& query : queries) {
+		expected.push_back(search_server.FindTopDocuments(query));
+	}
+
+	for (const size_t worker_count : {1, 4}) {
+		ThreadPool pool(worker_count);
+		const auto results = ProcessQueries(pool, search_server, queries);
+		ASSERT_EQUAL(results.size(), queries.size());
+		vector<Document> expected_joined;
+		for (size_t i = 0; i < queries.size(); ++i) {
+			ASSERT_SAME_DOCUMENTS_HINT(results[i], expected[i], queries[i]);
+			expected_joined.insert(expected_joined.end(), expected[i].begin(), expected[i].end());
+		}
+		const vector<Document> joined = ProcessQueriesJoined(pool, search_server, queries);
+		ASSERT_SAME_DOCUMENTS(joined, expected_joined);
+		// Итоговый вектор выделен ровно под результаты, а не по верхней оценке
+		ASSERT_EQUAL(joined.capacity(), expected_joined.size());
+
+		for (const ResultOrder order : {ResultOrder::ORDERED, ResultOrder::UNORDERED}) {
+			vector<vector<Document>> streamed(queries.size());
+			vector<int> calls(queries.size());
+			size_t next_index = 0;
+			bool is_in_order = true;
+			ProcessQueriesStream(pool, search_server, queries, order, [&](size_t i, const vector<Document>& documents) {
+				is_in_order = is_in_order && i == next_index++;
+				streamed[i] = documents;
+				++calls[i];
+			});
+			for (size_t i = 0; i < queries.size(); ++i) {
+				ASSERT_EQUAL(calls[i], 1);
+				ASSERT_SAME_DOCUMENTS_HINT(streamed[i], expected[i], queries[i]);
+			}
+			if (order == ResultOrder::ORDERED) {
+				ASSERT(is_in_order);
+			}
+		}
+	}
+	ASSERT_SAME_DOCUMENTS(ProcessQueries(search_server, queries).at(1), expected.at(1));
+}
+
+void TestEmptyAndInvalidBatches() {
+	SearchServer search_server("and"s);
+	search_server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+	ThreadPool pool(2);
+	ASSERT(ProcessQueries(pool, search_server, {}).empty());
+	ASSERT(ProcessQueriesJoined(pool, search_server, {}).empty());
+	ASSERT(ProcessQueriesJoined(pool, search_server, {"bird"s, "fish"s}).empty());
+	ASSERT_EQUAL(ProcessQueriesJoined(pool, search_server, {"bird"s, "cat"s, "dog"s}).size(), 2u);
+	ASSERT_THROWS(ProcessQueries(pool, search_server, {"cat"s, "cat --dog"s}), invalid_argument);
+	ASSERT_THROWS(ProcessQueriesJoined(pool, search_server, {"cat -"s}), invalid_argument);
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestBatchesMatchSequential);
+	RUN_TEST(TestEmptyAndInvalidBatches);
+}
@@ -0,0 +1,127 @@
+#include "search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+vector<Document> FindWithFreshContext(const SearchServer& search_server, const string& query, DocumentStatus status) {
+	QueryContext context;
+	return search_server.FindTopDocuments(context, query, status);
+}
+
+// Один контекст переходит между серверами разного размера, режимами ранжирования
+// и видами фильтров; каждый ответ совпадает с ответом на новом контексте
+void TestReusedContextMatchesFreshContext() {
+	const TestCorpus corpus = MakeCorpus(31, 3000);
+	SearchServer large("and"s);
+	FillServer(large, corpus);
+	SearchServer small("and"s);
+	for (int document_id = 0; document_id < 200; ++document_id) {
+		AddCorpusDocument(small, corpus, document_id);
+	}
+
+	QueryContext context;
+	for (int round = 0; round < 2; ++round) {
+		for (SearchServer* server : {&large, &small, &large}) {
+			SearchServer& search_server = *server;
+			for (const RankingMode mode : {RankingMode::EXHAUSTIVE, RankingMode::MAX_SCORE}) {
+				search_server.SetRankingMode(mode);
+				for (const string& query : corpus.queries) {
+					ASSERT_SAME_DOCUMENTS_HINT(vector<Document>(search_server.FindTopDocuments(context, query)),
+						FindWithFreshContext(search_server, query, DocumentStatus::ACTUAL), query);
+					ASSERT_SAME_DOCUMENTS_HINT(vector<Document>(search_server.FindTopDocuments(context, query, DocumentStatus::BANNED)),
+						FindWithFreshContext(search_server, query, DocumentStatus::BANNED), query);
+					const auto is_odd = [](int document_id, DocumentStatus, int) {
+						return document_id % 2 == 1;
+					};
+					ASSERT_SAME_DOCUMENTS_HINT(vector<Document>(search_server.FindTopDocuments(context, query, is_odd, 3)),
+						search_server.FindTopDocuments(query, is_odd, 3), query);
+
+					const int document_id = corpus.queries.size() % search_server.GetDocumentCount();
+					const auto [words, status] = search_server.MatchDocument(context, query, document_id);
+					const auto [expected_words, expected_status] = search_server.MatchDocument(query, document_id);
+					ASSERT(words == expected_words);
+					ASSERT(status == expected_status);
+				}
+			}
+			search_server.SetRankingMode(RankingMode::EXHAUSTIVE);
+		}
+	}
+}
+
+// Исключение посреди запроса (из разбора или из предиката) не оставляет в контексте
+// грязных буферов: следующий запрос на нем считается верно
+void TestContextSurvivesExceptions() {
+	const TestCorpus corpus = MakeCorpus(32, 1000);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	QueryContext context;
+	for (const RankingMode mode : {RankingMode::EXHAUSTIVE, RankingMode::MAX_SCORE}) {
+		search_server.SetRankingMode(mode);
+		for (const string& query : corpus.queries) {
+			ASSERT_THROWS(search_server.FindTopDocuments(context, query + " --bad"s), invalid_argument);
+			int calls = 0;
+			ASSERT_THROWS(search_server.FindTopDocuments(context, query, [&calls](int, DocumentStatus, int) {
+				if (++calls == 5) {
+					throw runtime_error("predicate failed"s);
+				}
+				return true;
+			}), runtime_error);
+			ASSERT_SAME_DOCUMENTS_HINT(vector<Document>(search_server.FindTopDocuments(context, query)),
+				FindWithFreshContext(search_server, query, DocumentStatus::ACTUAL), query);
+		}
+	}
+}
+
+// Контекст потока и контексты рабочих пула не держат плотные массивы сверх предела
+void TestRetainedBytesLimit() {
+	const TestCorpus corpus = MakeCorpus(33, 20000);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	const string& query = corpus.queries[0];
+	const vector<Document> expected = FindWithFreshContext(search_server, query, DocumentStatus::ACTUAL);
+
+	QueryContext::SetRetainedBytesLimit(numeric_limits<size_t>::max());
+	ASSERT_SAME_DOCUMENTS(search_server.FindTopDocuments(query), expected);
+	ASSERT(ThreadQueryContext::GetThreadDenseBytes() >= 9 * 20000);
+
+	QueryContext::SetRetainedBytesLimit(100 * 1024);
+	ASSERT_SAME_DOCUMENTS(search_server.FindTopDocuments(query), expected);
+	ASSERT_EQUAL(ThreadQueryContext::GetThreadDenseBytes(), 0u);
+	ASSERT_SAME_DOCUMENTS(search_server.FindTopDocuments(query), expected);
+	ASSERT_EQUAL(ThreadQueryContext::GetThreadDenseBytes(), 0u);
+
+	// Массивы маленького индекса укладываются в предел и остаются
+	SearchServer small_server("and"s);
+	for (int document_id = 0; document_id < 1000; ++document_id) {
+		AddCorpusDocument(small_server, corpus, document_id);
+	}
+	small_server.FindTopDocuments(query);
+	const size_t small_bytes = ThreadQueryContext::GetThreadDenseBytes();
+	ASSERT(small_bytes > 0 && small_bytes <= 100 * 1024);
+
+	QueryContext::SetRetainedBytesLimit(0);
+	ThreadPool pool(1);
+	for (int round = 0; round < 2; ++round) {
+		pool.ParallelFor(1, [&](size_t, QueryContext& context) {
+			ASSERT_EQUAL(context.GetDenseBytes(), 0u);
+			ASSERT_SAME_DOCUMENTS(search_server.FindTopDocuments(context, query, DocumentStatus::ACTUAL), expected);
+		});
+	}
+	QueryContext::SetRetainedBytesLimit(QueryContext::DEFAULT_RETAINED_BYTES_LIMIT);
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestReusedContextMatchesFreshContext);
+	RUN_TEST(TestContextSurvivesExceptions);
+	RUN_TEST(TestRetainedBytesLimit);
+}
@@ -0,0 +1,181 @@
+#include "query_trace.h"
+#include "search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <atomic>
+#include <execution>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Счетчики и число вызовов этапов за прогон всех запросов корпуса
+template <typename Search>
+TraceSnapshot TraceQueries(const TestCorpus& corpus, Search search) {
+	ResetTrace();
+	for (const string& query : corpus.queries) {
+		search(query);
+	}
+	return CollectTrace();
+}
+
+void AssertSameCounters(const TraceSnapshot& actual, const TraceSnapshot& expected) {
+	for (size_t i = 0; i < TRACE_COUNTER_COUNT; ++i) {
+		ASSERT_EQUAL_HINT(actual.counters[i], expected.counters[i], string(GetTraceName(static_cast<TraceCounter>(i))));
+	}
+}
+
+#ifdef SEARCH_SERVER_TRACING
+
+// Последовательный и параллельный полный подсчет читают одни и те же вхождения и оценивают
+// одни и те же документы; MaxScore читает и оценивает не больше, но не ноль
+void TestCountersInAllRankingPaths() {
+	const TestCorpus corpus = MakeCorpus(111, 5000);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	for (int document_id = 0; document_id < 5000; document_id += 9) {
+		search_server.RemoveDocument(document_id);
+	}
+
+	const TraceSnapshot sequential = TraceQueries(corpus, [&](const string& query) {
+		search_server.FindTopDocuments(query);
+	});
+	ASSERT(sequential[TraceCounter::POSTINGS_SCANNED] > 0);
+	ASSERT_EQUAL(sequential[TraceStage::PARSE_QUERY].calls, corpus.queries.size());
+	ASSERT_EQUAL(sequential[TraceStage::TOP_DOCUMENTS].calls, corpus.queries.size());
+
+	uint64_t matched_count = 0;
+	for (const string& query : corpus.queries) {
+		matched_count += search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 5000).size();
+	}
+	ASSERT_EQUAL(sequential[TraceCounter::DOCUMENTS_SCORED], matched_count);
+
+	const TraceSnapshot parallel = TraceQueries(corpus, [&](const string& query) {
+		search_server.FindTopDocuments(execution::par, query);
+	});
+	AssertSameCounters(parallel, sequential);
+	ASSERT(parallel[TraceStage::TOP_DOCUMENTS].calls >= corpus.queries.size());
+
+	search_server.SetRankingMode(RankingMode::MAX_SCORE);
+	const TraceSnapshot max_score = TraceQueries(corpus, [&](const string& query) {
+		search_server.FindTopDocuments(query);
+	});
+	ASSERT(max_score[TraceCounter::POSTINGS_SCANNED] > 0);
+	ASSERT(max_score[TraceCounter::POSTINGS_SCANNED] <= sequential[TraceCounter::POSTINGS_SCANNED]);
+	ASSERT(max_score[TraceCounter::DOCUMENTS_SCORED] > 0);
+	ASSERT(max_score[TraceCounter::DOCUMENTS_SCORED] <= sequential[TraceCounter::DOCUMENTS_SCORED]);
+}
+
+// MaxScore по редкому слову на большом индексе посещает не больше окон, чем у слова вхождений,
+// а не все окна индекса
+void TestMaxScoreWorkBoundedByPostings() {
+	constexpr int DOCUMENT_COUNT = 200000;
+	constexpr int SPACING = 9973;
+	const TestCorpus corpus = MakeRareTermCorpus(DOCUMENT_COUNT, SPACING);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	search_server.SetRankingMode(RankingMode::MAX_SCORE);
+	const uint64_t rare_count = (DOCUMENT_COUNT + SPACING - 1) / SPACING;
+	ResetTrace();
+	ASSERT_EQUAL(search_server.FindTopDocuments("rare"s, DocumentFilter()).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+	const TraceSnapshot snapshot = CollectTrace();
+	ASSERT_EQUAL(snapshot[TraceCounter::POSTINGS_SCANNED], rare_count);
+	ASSERT(snapshot[TraceCounter::MAX_SCORE_WINDOWS] > 0);
+	ASSERT_HINT(snapshot[TraceCounter::MAX_SCORE_WINDOWS] <= rare_count,
+		to_string(snapshot[TraceCounter::MAX_SCORE_WINDOWS]));
+}
+
+// Сброс обнуляет суммы и максимумы, счетчики завершившихся потоков сохраняются
+void TestResetAndExitedThreads() {
+	const TestCorpus corpus = MakeCorpus(112, 1000);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	search_server.FindTopDocuments(corpus.queries[0]);
+	ResetTrace();
+	const TraceSnapshot empty = CollectTrace();
+	for (size_t i = 0; i < TRACE_STAGE_COUNT; ++i) {
+		ASSERT_EQUAL(empty.stages[i].calls, 0u);
+		ASSERT_EQUAL(empty.stages[i].max_time.count(), 0);
+	}
+
+	thread worker([&] {
+		for (const string& query : corpus.queries) {
+			search_server.FindTopDocuments(query);
+		}
+	});
+	worker.join();
+	const TraceSnapshot after_exit = CollectTrace();
+	ASSERT_EQUAL(after_exit[TraceStage::PARSE_QUERY].calls, corpus.queries.size());
+	ASSERT(after_exit[TraceStage::TOP_DOCUMENTS].max_time.count() > 0);
+	ASSERT(after_exit[TraceStage::TOP_DOCUMENTS].max_time <= after_exit[TraceStage::TOP_DOCUMENTS].total_time);
+
+	SetTraceTimersEnabled(false);
+	ResetTrace();
+	search_server.FindTopDocuments(corpus.queries[0]);
+	ASSERT_EQUAL(CollectTrace()[TraceStage::PARSE_QUERY].calls, 1u);
+	ASSERT_EQUAL(CollectTrace()[TraceStage::PARSE_QUERY].total_time.count(), 0);
+	SetTraceTimersEnabled(true);
+}
+
+// Сброс во время записи из другого потока: после остановки писателя и сброса
+// не остается ни вызовов, ни максимумов
+void TestResetDuringQueries() {
+	const TestCorpus corpus = MakeCorpus(113, 2000);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	atomic<bool> is_running = true;
+	thread writer([&] {
+		size_t i = 0;
+		while (is_running) {
+			search_server.FindTopDocuments(corpus.queries[i++ % corpus.queries.size()]);
+		}
+	});
+	for (int i = 0; i < 1000; ++i) {
+		ResetTrace();
+		CollectTrace();
+	}
+	is_running = false;
+	writer.join();
+	ResetTrace();
+	const TraceSnapshot snapshot = CollectTrace();
+	for (const TraceStageStats& stats : snapshot.stages) {
+		ASSERT_EQUAL(stats.calls, 0u);
+		ASSERT_EQUAL(stats.max_time.count(), 0);
+	}
+}
+
+#else
+
+// Без SEARCH_SERVER_TRACING запросы ничего не считают
+void TestTracingDisabled() {
+	const TestCorpus corpus = MakeCorpus(114, 1000);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	const TraceSnapshot snapshot = TraceQueries(corpus, [&](const string& query) {
+		search_server.FindTopDocuments(query);
+		search_server.FindTopDocuments(execution::par, query);
+	});
+	AssertSameCounters(snapshot, TraceSnapshot{});
+	for (const TraceStageStats& stats : snapshot.stages) {
+		ASSERT_EQUAL(stats.calls, 0u);
+	}
+}
+
+#endif
+
+}  // namespace
+
+int main() {
+#ifdef SEARCH_SERVER_TRACING
+	RUN_TEST(TestCountersInAllRankingPaths);
+	RUN_TEST(TestMaxScoreWorkBoundedByPostings);
+	RUN_TEST(TestResetAndExitedThreads);
+	RUN_TEST(TestResetDuringQueries);
+#else
+	RUN_TEST(TestTracingDisabled);
+#endif
+}
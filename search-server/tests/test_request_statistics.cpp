@@ -0,0 +1,173 @@
+#include "request_queue.h"
+#include "request_statistics.h"
+#include "result_cache.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+using Clock = RequestStatistics::Clock;
+
+struct Event {
+	Clock::time_point time;
+	chrono::microseconds latency;
+	size_t matched_document_count;
+};
+
+// Итоги по всем событиям из BUCKET_COUNT интервалов, последний из которых содержит now
+RequestStatistics::Summary CountWindow(const vector<Event>& events, Clock::time_point now, Clock::duration bucket_duration) {
+	const int64_t last_epoch = now.time_since_epoch() / bucket_duration;
+	RequestStatistics::Summary summary;
+	for (const Event& event : events) {
+		const int64_t epoch = event.time.time_since_epoch() / bucket_duration;
+		if (epoch <= last_epoch && epoch > last_epoch - static_cast<int64_t>(RequestStatistics::BUCKET_COUNT)) {
+			++summary.request_count;
+			summary.no_result_count += event.matched_document_count == 0;
+			summary.matched_document_count += event.matched_document_count;
+		}
+	}
+	return summary;
+}
+
+void AssertSameCounts(const RequestStatistics::Summary& actual, const RequestStatistics::Summary& expected, const string& hint) {
+	ASSERT_EQUAL_HINT(actual.request_count, expected.request_count, hint);
+	ASSERT_EQUAL_HINT(actual.no_result_count, expected.no_result_count, hint);
+	ASSERT_EQUAL_HINT(actual.matched_document_count, expected.matched_document_count, hint);
+}
+
+// Итоги совпадают с прямым подсчетом по окну, в том числе после простоя дольше окна
+void TestMatchesSlidingWindow() {
+	const auto bucket_duration = chrono::seconds(1);
+	RequestStatistics statistics(bucket_duration);
+	mt19937 generator(101);
+	vector<Event> events;
+	Clock::time_point now = Clock::now();
+	for (int i = 0; i < 5000; ++i) {
+		const int gap = uniform_int_distribution<int>(0, 99)(generator);
+		if (gap == 0) {
+			now += chrono::seconds(RequestStatistics::BUCKET_COUNT + 100);
+		} else if (gap < 10) {
+			now += chrono::seconds(uniform_int_distribution<int>(1, 800)(generator));
+		} else if (gap < 50) {
+			now += chrono::milliseconds(uniform_int_distribution<int>(1, 2000)(generator));
+		}
+		const size_t matched = uniform_int_distribution<size_t>(0, 3)(generator);
+		events.push_back({now, chrono::microseconds(uniform_int_distribution<int>(0, 5000)(generator)), matched});
+		statistics.Record(now, events.back().latency, matched);
+		if (i % 7 == 0) {
+			AssertSameCounts(statistics.GetSummary(now), CountWindow(events, now, bucket_duration), to_string(i));
+		}
+	}
+	for (const int seconds : {1, 100, 1000, 1439, 1440, 5000}) {
+		const Clock::time_point later = now + chrono::seconds(seconds);
+		AssertSameCounts(statistics.GetSummary(later), CountWindow(events, later, bucket_duration), to_string(seconds));
+	}
+	ASSERT_EQUAL(statistics.GetSummary(now + chrono::hours(48)).request_count, 0u);
+}
+
+// Запрос, интервал которого уже выпал из окна, не учитывается
+void TestLateRecordIsIgnored() {
+	RequestStatistics statistics(chrono::seconds(1));
+	const Clock::time_point now = Clock::now();
+	statistics.Record(now, chrono::microseconds(10), 1);
+	const Clock::time_point later = now + chrono::seconds(RequestStatistics::BUCKET_COUNT + 10);
+	ASSERT_EQUAL(statistics.GetSummary(later).request_count, 0u);
+	statistics.Record(now, chrono::microseconds(10), 1);
+	ASSERT_EQUAL(statistics.GetSummary(later).request_count, 0u);
+	statistics.Record(later, chrono::microseconds(10), 0);
+	const RequestStatistics::Summary summary = statistics.GetSummary(later);
+	ASSERT_EQUAL(summary.request_count, 1u);
+	ASSERT_EQUAL(summary.no_result_count, 1u);
+}
+
+// Перцентили задержек - верхние границы корзин не дальше 25% от точного значения
+void TestLatencyPercentiles() {
+	RequestStatistics statistics;
+	const Clock::time_point now = Clock::now();
+	ASSERT_EQUAL(statistics.GetSummary(now).latency_p99.count(), 0);
+	for (int latency = 1; latency <= 10000; ++latency) {
+		statistics.Record(now, chrono::microseconds(latency), 1);
+	}
+	const RequestStatistics::Summary summary = statistics.GetSummary(now);
+	const auto check = [](chrono::microseconds actual, int64_t exact) {
+		ASSERT_HINT(actual.count() >= exact && actual.count() <= exact * 5 / 4 + 1, to_string(actual.count()));
+	};
+	check(summary.latency_p50, 5000);
+	check(summary.latency_p95, 9500);
+	check(summary.latency_p99, 9900);
+}
+
+// Одновременные записи из нескольких потоков, в том числе в новые корзины, не теряются
+void TestConcurrentRecords() {
+	RequestStatistics statistics(chrono::seconds(1));
+	const Clock::time_point start = Clock::now();
+	constexpr int THREAD_COUNT = 4;
+	constexpr int RECORD_COUNT = 20000;
+	vector<thread> threads;
+	for (int thread_index = 0; thread_index < THREAD_COUNT; ++thread_index) {
+		threads.emplace_back([&statistics, start] {
+			for (int i = 0; i < RECORD_COUNT; ++i) {
+				statistics.Record(start + chrono::milliseconds(i / 10), chrono::microseconds(i % 100), i % 3);
+			}
+		});
+	}
+	for (thread& thread : threads) {
+		thread.join();
+	}
+	const RequestStatistics::Summary summary = statistics.GetSummary(start + chrono::milliseconds(RECORD_COUNT / 10));
+	ASSERT_EQUAL(summary.request_count, static_cast<uint64_t>(THREAD_COUNT) * RECORD_COUNT);
+	ASSERT_EQUAL(summary.no_result_count, static_cast<uint64_t>(THREAD_COUNT) * ((RECORD_COUNT + 2) / 3));
+	uint64_t matched_document_count = 0;
+	for (int i = 0; i < RECORD_COUNT; ++i) {
+		matched_document_count += i % 3;
+	}
+	ASSERT_EQUAL(summary.matched_document_count, THREAD_COUNT * matched_document_count);
+}
+
+// Очередь возвращает обычные ответы сервера, с кэшем и без, и считает пустые ответы
+void TestRequestQueue() {
+	const TestCorpus corpus = MakeCorpus(102, 1000);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	ResultCache cache(1000);
+	RequestQueue plain_queue(search_server);
+	RequestQueue cached_queue(search_server, cache);
+	vector<string> queries = corpus.queries;
+	queries.push_back("nosuchword"s);
+	queries.push_back("and"s);
+	uint64_t no_result_count = 0;
+	for (int round = 0; round < 2; ++round) {
+		for (const string& query : queries) {
+			const vector<Document> expected = search_server.FindTopDocuments(query);
+			no_result_count += expected.empty();
+			ASSERT_SAME_DOCUMENTS_HINT(plain_queue.AddFindRequest(query), expected, query);
+			ASSERT_SAME_DOCUMENTS_HINT(cached_queue.AddFindRequest(query), expected, query);
+			ASSERT_SAME_DOCUMENTS_HINT(plain_queue.AddFindRequest(query, DocumentStatus::BANNED),
+				search_server.FindTopDocuments(query, DocumentStatus::BANNED), query);
+			no_result_count += search_server.FindTopDocuments(query, DocumentStatus::BANNED).empty();
+		}
+	}
+	ASSERT(no_result_count >= 4);
+	ASSERT_EQUAL(static_cast<uint64_t>(plain_queue.GetNoResultRequests()), no_result_count);
+	ASSERT_EQUAL(plain_queue.GetStatistics().request_count, 4 * queries.size());
+	ASSERT_EQUAL(cached_queue.GetStatistics().request_count, 2 * queries.size());
+	ASSERT(cache.GetHitCount() >= queries.size());
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestMatchesSlidingWindow);
+	RUN_TEST(TestLateRecordIsIgnored);
+	RUN_TEST(TestLatencyPercentiles);
+	RUN_TEST(TestConcurrentRecords);
+	RUN_TEST(TestRequestQueue);
+}
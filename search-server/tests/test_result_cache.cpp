@@ -0,0 +1,166 @@
+#include "process_queries.h"
+#include "result_cache.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Те же слова в обратном порядке и с повтором первого слова
+string ShuffleQuery(const string& query) {
+	vector<string_view> words = SplitIntoWords(query);
+	reverse(words.begin(), words.end());
+	string shuffled;
+	for (const string_view word : words) {
+		shuffled += word;
+		shuffled += ' ';
+	}
+	return shuffled + string(words.back());
+}
+
+// Ответы кэша совпадают с поиском без кэша, а запросы с переставленными словами попадают в кэш
+void TestMatchesUncachedSearch() {
+	const TestCorpus corpus = MakeCorpus(91, 2000);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	ResultCache cache(1000);
+	const DocumentFilter filter = DocumentFilter().SetStatuses({DocumentStatus::ACTUAL, DocumentStatus::BANNED}).SetRatingRange(100, 1500);
+	for (int round = 0; round < 2; ++round) {
+		for (const string& query : corpus.queries) {
+			ASSERT_SAME_DOCUMENTS_HINT(cache.FindTopDocuments(search_server, query), search_server.FindTopDocuments(query), query);
+			ASSERT_SAME_DOCUMENTS_HINT(cache.FindTopDocuments(search_server, query, filter, 3),
+				search_server.FindTopDocuments(query, filter, 3), query);
+		}
+	}
+	const uint64_t miss_count = cache.GetMissCount();
+	ASSERT(miss_count <= 2 * corpus.queries.size());
+	ASSERT_EQUAL(cache.GetHitCount() + miss_count, 4 * corpus.queries.size());
+
+	for (const string& query : corpus.queries) {
+		ASSERT_SAME_DOCUMENTS_HINT(cache.FindTopDocuments(search_server, ShuffleQuery(query)),
+			search_server.FindTopDocuments(query), query);
+	}
+	ASSERT_EQUAL(cache.GetMissCount(), miss_count);
+
+	// Некорректный запрос не попадает в кэш и каждый раз отклоняется
+	const size_t size = cache.size();
+	ASSERT_THROWS(cache.FindTopDocuments(search_server, "cat --dog"s), invalid_argument);
+	ASSERT_THROWS(cache.FindTopDocuments(search_server, "cat --dog"s), invalid_argument);
+	ASSERT_EQUAL(cache.size(), size);
+}
+
+// После изменения сервера кэш отдает новые ответы, а записи прежнего поколения удаляются
+// при первом обращении к их сегменту, даже если их запросы больше не повторяются.
+// Записи другого сервера при этом остаются
+void TestModificationPurgesStaleEntries() {
+	const TestCorpus corpus = MakeCorpus(92, 2000);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	SearchServer other_server("and"s);
+	FillServer(other_server, corpus);
+	ResultCache cache(4000);
+	for (const string& query : corpus.queries) {
+		cache.FindTopDocuments(search_server, query);
+		cache.FindTopDocuments(other_server, query);
+	}
+	ASSERT_EQUAL(cache.size(), 2 * corpus.queries.size());
+
+	for (int document_id = 0; document_id < 2000; document_id += 3) {
+		search_server.RemoveDocument(document_id);
+	}
+	AddCorpusDocument(search_server, corpus, 5000);
+	for (size_t max_count = 1; max_count <= 20; ++max_count) {
+		for (const string& query : corpus.queries) {
+			ASSERT_SAME_DOCUMENTS_HINT(cache.FindTopDocuments(search_server, query, DocumentStatus::ACTUAL, max_count),
+				search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, max_count), query);
+		}
+	}
+	ASSERT_EQUAL(cache.size(), 21 * corpus.queries.size());
+
+	const uint64_t hit_count = cache.GetHitCount();
+	for (const string& query : corpus.queries) {
+		ASSERT_SAME_DOCUMENTS_HINT(cache.FindTopDocuments(other_server, query), other_server.FindTopDocuments(query), query);
+	}
+	ASSERT_EQUAL(cache.GetHitCount(), hit_count + corpus.queries.size());
+}
+
+// Копия сервера, снимок и новый сервер на месте уничтоженного не получают чужих ответов,
+// даже если у них тот же адрес и то же поколение
+void TestServerIdentity() {
+	const TestCorpus corpus = MakeCorpus(93, 1000);
+	const string path = (filesystem::temp_directory_path() / ("test_result_cache_"s + to_string(getpid()) + ".bin"s)).string();
+	optional<SearchServer> search_server(in_place, "and"s);
+	FillServer(*search_server, corpus);
+	search_server->SaveSnapshot(path);
+	ResultCache cache(1000);
+	for (const string& query : corpus.queries) {
+		cache.FindTopDocuments(*search_server, query);
+	}
+
+	const SearchServer copy = *search_server;
+	const uint64_t miss_count = cache.GetMissCount();
+	for (const string& query : corpus.queries) {
+		ASSERT_SAME_DOCUMENTS_HINT(cache.FindTopDocuments(copy, query), search_server->FindTopDocuments(query), query);
+	}
+	ASSERT(cache.GetMissCount() > miss_count);
+
+	search_server.reset();
+	search_server.emplace(SearchServer::LoadSnapshot(path));
+	filesystem::remove(path);
+	for (int document_id = 0; document_id < 1000; document_id += 2) {
+		search_server->RemoveDocument(document_id);
+	}
+	for (const string& query : corpus.queries) {
+		ASSERT_SAME_DOCUMENTS_HINT(cache.FindTopDocuments(*search_server, query), search_server->FindTopDocuments(query), query);
+	}
+
+	search_server.reset();
+	search_server.emplace("and"s);
+	for (int document_id = 0; document_id < 1000; document_id += 5) {
+		AddCorpusDocument(*search_server, corpus, document_id);
+	}
+	for (const string& query : corpus.queries) {
+		ASSERT_SAME_DOCUMENTS_HINT(cache.FindTopDocuments(*search_server, query), search_server->FindTopDocuments(query), query);
+	}
+}
+
+// Размер кэша ограничен, а параллельные запросы через ProcessQueries дают обычные ответы
+void TestCapacityAndConcurrentUse() {
+	const TestCorpus corpus = MakeCorpus(94, 3000, 1000);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	ResultCache small_cache(100);
+	for (const string& query : corpus.queries) {
+		small_cache.FindTopDocuments(search_server, query);
+	}
+	ASSERT_HINT(small_cache.size() <= 112, to_string(small_cache.size()));
+
+	ThreadPool pool(4);
+	ResultCache cache(2000);
+	const vector<vector<Document>> expected = ProcessQueries(pool, search_server, corpus.queries);
+	for (int round = 0; round < 3; ++round) {
+		const vector<vector<Document>> cached = ProcessQueries(pool, search_server, corpus.queries, cache);
+		for (size_t i = 0; i < corpus.queries.size(); ++i) {
+			ASSERT_SAME_DOCUMENTS_HINT(cached[i], expected[i], corpus.queries[i]);
+		}
+	}
+	ASSERT(cache.GetHitCount() >= 2 * corpus.queries.size());
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestMatchesUncachedSearch);
+	RUN_TEST(TestModificationPurgesStaleEntries);
+	RUN_TEST(TestServerIdentity);
+	RUN_TEST(TestCapacityAndConcurrentUse);
+}
@@ -0,0 +1,161 @@
+#include "search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void TestFindAndMatch() {
+	SearchServer search_server("and in on"s);
+	search_server.AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, {8, -3});
+	search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+	search_server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+	search_server.AddDocument(4, "groomed starling eugene"s, DocumentStatus::BANNED, {9});
+
+	const auto documents = search_server.FindTopDocuments("fluffy groomed cat"s);
+	ASSERT_EQUAL(documents.size(), 3u);
+	ASSERT_EQUAL(documents[0].id, 2);
+	// У документов 1 и 3 релевантность равна, выше тот, у кого больше рейтинг
+	ASSERT_EQUAL(documents[1].id, 1);
+	ASSERT_EQUAL(documents[2].id, 3);
+	ASSERT_EQUAL(documents[0].rating, 5);
+
+	ASSERT(search_server.FindTopDocuments("cat -fluffy"s).size() == 1);
+	ASSERT_EQUAL(search_server.FindTopDocuments("groomed"s, DocumentStatus::BANNED).at(0).id, 4);
+	ASSERT(search_server.FindTopDocuments("and in"s).empty());
+
+	const auto [words, status] = search_server.MatchDocument("fluffy cat -dog"s, 2);
+	ASSERT_EQUAL(words.size(), 2u);
+	ASSERT(status == DocumentStatus::ACTUAL);
+	ASSERT(get<0>(search_server.MatchDocument("cat -tail"s, 2)).empty());
+
+	ASSERT_THROWS(search_server.AddDocument(1, "dup"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+	ASSERT_THROWS(search_server.AddDocument(-1, "neg"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+	ASSERT_THROWS(search_server.FindTopDocuments("cat --dog"s), invalid_argument);
+	ASSERT_THROWS(search_server.FindTopDocuments("cat -"s), invalid_argument);
+}
+
+void TestRemoveDocument() {
+	SearchServer search_server("and"s);
+	search_server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+	search_server.AddDocument(2, "cat bird"s, DocumentStatus::ACTUAL, {2});
+	search_server.RemoveDocument(1);
+	ASSERT_EQUAL(search_server.GetDocumentCount(), 1);
+	ASSERT_EQUAL(search_server.GetDocumentFrequency("cat"s), 1);
+	ASSERT_EQUAL(search_server.GetDocumentFrequency("dog"s), 0);
+	ASSERT(search_server.FindTopDocuments("dog"s).empty());
+	ASSERT(search_server.GetWordFrequencies(1).empty());
+	ASSERT_THROWS(search_server.MatchDocument("cat"s, 1), out_of_range);
+	// Удаленный id можно добавить заново
+	search_server.AddDocument(1, "dog"s, DocumentStatus::ACTUAL, {3});
+	ASSERT_EQUAL(search_server.FindTopDocuments("dog"s).at(0).rating, 3);
+}
+
+// IDF берется из кэша по поколению корпуса: после добавления и удаления документов
+// релевантность пересчитывается по новому числу документов
+void TestInverseDocumentFreqFollowsCorpus() {
+	SearchServer search_server("and"s);
+	search_server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+	search_server.AddDocument(2, "cat bird"s, DocumentStatus::ACTUAL, {2});
+	const auto relevance_of = [&search_server](const string& query) {
+		return search_server.FindTopDocuments(query).at(0).relevance;
+	};
+	const uint64_t generation = search_server.GetGeneration();
+	ASSERT(abs(relevance_of("dog"s) - 0.5 * log(2.0)) < 1e-12);
+
+	search_server.AddDocument(3, "fish"s, DocumentStatus::ACTUAL, {3});
+	ASSERT(search_server.GetGeneration() > generation);
+	ASSERT(abs(relevance_of("dog"s) - 0.5 * log(3.0)) < 1e-12);
+	ASSERT(abs(relevance_of("cat"s) - 0.5 * log(3.0 / 2.0)) < 1e-12);
+
+	search_server.RemoveDocument(2);
+	ASSERT(abs(relevance_of("cat"s) - 0.5 * log(2.0)) < 1e-12);
+	ASSERT(abs(search_server.FindTopDocuments(execution::par, "cat"s).at(0).relevance - 0.5 * log(2.0)) < 1e-12);
+}
+
+// Много циклов добавления и удаления с уплотнением: результаты совпадают с сервером,
+// построенным заново только из живых документов, во всех режимах ранжирования
+void TestRemoveHeavyMatchesRebuiltServer() {
+	const TestCorpus corpus = MakeCorpus(5, 3000);
+	mt19937 generator(7);
+	for (const PostingFormat format : {PostingFormat::PLAIN, PostingFormat::COMPRESSED}) {
+		SearchServer search_server("and"s);
+		search_server.SetPostingFormat(format);
+		vector<int> live_ids;
+		int next_id = 0;
+		for (int round = 0; round < 4; ++round) {
+			for (int i = 0; i < 1500; ++i) {
+				AddCorpusDocument(search_server, corpus, next_id);
+				live_ids.push_back(next_id++);
+			}
+			shuffle(live_ids.begin(), live_ids.end(), generator);
+			const size_t remove_count = live_ids.size() * 2 / 3;
+			for (size_t i = 0; i < remove_count; ++i) {
+				if (i % 2 == 0) {
+					search_server.RemoveDocument(live_ids[i]);
+				} else {
+					search_server.RemoveDocument(execution::par, live_ids[i]);
+				}
+			}
+			live_ids.erase(live_ids.begin(), live_ids.begin() + remove_count);
+
+			SearchServer rebuilt("and"s);
+			for (const int document_id : live_ids) {
+				AddCorpusDocument(rebuilt, corpus, document_id);
+			}
+			ASSERT_EQUAL(search_server.GetDocumentCount(), rebuilt.GetDocumentCount());
+			for (const string& query : corpus.queries) {
+				const auto expected = rebuilt.FindTopDocuments(query);
+				search_server.SetRankingMode(RankingMode::EXHAUSTIVE);
+				ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(query), expected, query);
+				ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(execution::par, query), expected, query);
+				ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(query, DocumentStatus::BANNED),
+					rebuilt.FindTopDocuments(query, DocumentStatus::BANNED), query);
+				const auto is_even = [](int document_id, DocumentStatus, int) {
+					return document_id % 2 == 0;
+				};
+				ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(query, is_even),
+					rebuilt.FindTopDocuments(query, is_even), query);
+				search_server.SetRankingMode(RankingMode::MAX_SCORE);
+				ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(query), expected, query);
+
+				const int document_id = live_ids.front();
+				ASSERT(get<0>(search_server.MatchDocument(query, document_id)) == get<0>(rebuilt.MatchDocument(query, document_id)));
+			}
+			for (const string& word : corpus.dictionary) {
+				ASSERT_EQUAL_HINT(search_server.GetDocumentFrequency(word), rebuilt.GetDocumentFrequency(word), word);
+			}
+		}
+	}
+}
+
+// Перегрузки без контекста пользуются контекстом потока; запрос из предиката
+// другого запроса не должен портить его буферы
+void TestNestedQueryFromPredicate() {
+	SearchServer search_server("and"s);
+	search_server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+	search_server.AddDocument(2, "cat bird"s, DocumentStatus::ACTUAL, {2});
+	search_server.AddDocument(3, "bird"s, DocumentStatus::ACTUAL, {3});
+	const auto documents = search_server.FindTopDocuments("cat"s, [&](int document_id, DocumentStatus, int) {
+		return !search_server.FindTopDocuments("bird"s).empty() && document_id != 1;
+	});
+	ASSERT_EQUAL(documents.size(), 1u);
+	ASSERT_EQUAL(documents[0].id, 2);
+	ASSERT_EQUAL(search_server.FindTopDocuments("bird"s).size(), 2u);
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestFindAndMatch);
+	RUN_TEST(TestRemoveDocument);
+	RUN_TEST(TestInverseDocumentFreqFollowsCorpus);
+	RUN_TEST(TestRemoveHeavyMatchesRebuiltServer);
+	RUN_TEST(TestNestedQueryFromPredicate);
+}
@@ -0,0 +1,98 @@
+#include "sharded_search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void AssertSameAsSingleServer(const ShardedSearchServer& sharded, const SearchServer& single, const TestCorpus& corpus) {
+	ASSERT_EQUAL(sharded.GetDocumentCount(), single.GetDocumentCount());
+	const auto is_even = [](int document_id, DocumentStatus, int) {
+		return document_id % 2 == 0;
+	};
+	const DocumentFilter filter = DocumentFilter().SetStatuses({DocumentStatus::ACTUAL, DocumentStatus::BANNED});
+	for (const string& query : corpus.queries) {
+		ASSERT_SAME_DOCUMENTS_HINT(sharded.FindTopDocuments(query), single.FindTopDocuments(query), query);
+		ASSERT_SAME_DOCUMENTS_HINT(sharded.FindTopDocuments(query, DocumentStatus::IRRELEVANT),
+			single.FindTopDocuments(query, DocumentStatus::IRRELEVANT), query);
+		ASSERT_SAME_DOCUMENTS_HINT(sharded.FindTopDocuments(query, is_even, 3), single.FindTopDocuments(query, is_even, 3), query);
+		ASSERT_SAME_DOCUMENTS_HINT(sharded.FindTopDocuments(query, filter), single.FindTopDocuments(query, filter), query);
+	}
+	for (const int document_id : single) {
+		const string& query = corpus.queries[document_id % corpus.queries.size()];
+		ASSERT(sharded.MatchDocument(query, document_id) == single.MatchDocument(query, document_id));
+	}
+}
+
+// Ответы совпадают с одним сервером со всеми документами, в обоих режимах ранжирования
+// и после удалений: IDF считается по всему корпусу
+void TestMatchesSingleServer() {
+	const TestCorpus corpus = MakeCorpus(71, 3000);
+	for (const size_t shard_count : {1, 3, 8}) {
+		ShardedSearchServer sharded("and"s, shard_count);
+		SearchServer single("and"s);
+		vector<NewDocument> batch;
+		for (int document_id = 0; document_id < 3000; ++document_id) {
+			if (document_id < 500) {
+				AddCorpusDocument(sharded, corpus, document_id);
+			} else {
+				batch.push_back(MakeCorpusDocument(corpus, document_id));
+			}
+			AddCorpusDocument(single, corpus, document_id);
+		}
+		sharded.AddDocuments(batch);
+		for (int document_id = 0; document_id < 3000; document_id += 7) {
+			sharded.RemoveDocument(document_id);
+			single.RemoveDocument(document_id);
+		}
+		for (const RankingMode mode : {RankingMode::EXHAUSTIVE, RankingMode::MAX_SCORE}) {
+			sharded.SetRankingMode(mode);
+			single.SetRankingMode(mode);
+			AssertSameAsSingleServer(sharded, single, corpus);
+		}
+	}
+}
+
+// Некорректный документ любой части отклоняет весь пакет до изменения остальных частей
+void TestInvalidBatchChangesNoShard() {
+	const TestCorpus corpus = MakeCorpus(72, 1000);
+	ShardedSearchServer sharded("and"s, 4);
+	SearchServer single("and"s);
+	for (int document_id = 0; document_id < 400; ++document_id) {
+		AddCorpusDocument(sharded, corpus, document_id);
+		AddCorpusDocument(single, corpus, document_id);
+	}
+	vector<uint64_t> generations;
+	for (size_t shard = 0; shard < sharded.GetShardCount(); ++shard) {
+		generations.push_back(sharded.GetShard(shard).GetGeneration());
+	}
+	const auto make_batch = [&corpus](NewDocument bad_document) {
+		vector<NewDocument> batch;
+		for (int document_id = 400; document_id < 1000; ++document_id) {
+			batch.push_back(MakeCorpusDocument(corpus, document_id));
+		}
+		batch.push_back(move(bad_document));
+		return batch;
+	};
+	ASSERT_THROWS(sharded.AddDocuments(make_batch({17, "cat"sv, DocumentStatus::ACTUAL, {}})), invalid_argument);
+	ASSERT_THROWS(sharded.AddDocuments(make_batch({700, "cat"sv, DocumentStatus::ACTUAL, {}})), invalid_argument);
+	ASSERT_THROWS(sharded.AddDocuments(make_batch({-3, "cat"sv, DocumentStatus::ACTUAL, {}})), invalid_argument);
+	ASSERT_THROWS(sharded.AddDocuments(make_batch({2000, "c\x01t"sv, DocumentStatus::ACTUAL, {}})), invalid_argument);
+	for (size_t shard = 0; shard < sharded.GetShardCount(); ++shard) {
+		ASSERT_EQUAL(sharded.GetShard(shard).GetGeneration(), generations[shard]);
+	}
+	AssertSameAsSingleServer(sharded, single, corpus);
+	ASSERT_THROWS(ShardedSearchServer("and"s, 0), invalid_argument);
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestMatchesSingleServer);
+	RUN_TEST(TestInvalidBatchChangesNoShard);
+}
@@ -0,0 +1,198 @@
+#include "search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+// Смещения полей заголовка повторяют раскладку SnapshotHeader из search_server_snapshot.cpp
+constexpr size_t POSTING_COUNT_FIELD = 72;
+constexpr size_t POSTING_OFFSETS_FIELD = 80;
+constexpr size_t POSTING_DOCUMENT_INDEXES_FIELD = 88;
+constexpr size_t DOCUMENT_COUNT_FIELD = 104;
+constexpr size_t DOCUMENT_IDS_FIELD = 112;
+constexpr size_t DOCUMENT_STATUSES_FIELD = 128;
+
+string GetSnapshotPath() {
+	return (filesystem::temp_directory_path() / ("test_snapshot_"s + to_string(getpid()) + ".bin"s)).string();
+}
+
+vector<char> ReadFile(const string& path) {
+	ifstream in(path, ios::binary);
+	return vector<char>(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+void WriteFile(const string& path, const vector<char>& data) {
+	ofstream out(path, ios::binary | ios::trunc);
+	out.write(data.data(), data.size());
+}
+
+template <typename T>
+T& At(vector<char>& data, size_t offset) {
+	return *reinterpret_cast<T*>(data.data() + offset);
+}
+
+void AssertSameServers(const SearchServer& loaded, const SearchServer& expected, const TestCorpus& corpus) {
+	ASSERT_EQUAL(loaded.GetDocumentCount(), expected.GetDocumentCount());
+	for (const string& query : corpus.queries) {
+		ASSERT_SAME_DOCUMENTS_HINT(loaded.FindTopDocuments(query), expected.FindTopDocuments(query), query);
+		ASSERT_SAME_DOCUMENTS_HINT(loaded.FindTopDocuments(execution::par, query),
+			expected.FindTopDocuments(query), query);
+		ASSERT_SAME_DOCUMENTS_HINT(loaded.FindTopDocuments(query, DocumentStatus::BANNED),
+			expected.FindTopDocuments(query, DocumentStatus::BANNED), query);
+	}
+	for (const int document_id : expected) {
+		ASSERT(loaded.GetWordFrequencies(document_id) == expected.GetWordFrequencies(document_id));
+		const string& query = corpus.queries[document_id % corpus.queries.size()];
+		ASSERT(loaded.MatchDocument(query, document_id) == expected.MatchDocument(query, document_id));
+	}
+	for (const string& word : corpus.dictionary) {
+		ASSERT_EQUAL_HINT(loaded.GetDocumentFrequency(word), expected.GetDocumentFrequency(word), word);
+	}
+}
+
+// Снимок сервера с удаленными документами загружается в сервер с теми же ответами,
+// и загруженный сервер дальше принимает добавления и удаления
+void TestRoundTripWithRemovedDocuments() {
+	const TestCorpus corpus = MakeCorpus(11, 2000);
+	const string path = GetSnapshotPath();
+	for (const PostingFormat format : {PostingFormat::PLAIN, PostingFormat::COMPRESSED}) {
+		SearchServer search_server("and in on"s);
+		search_server.SetPostingFormat(format);
+		FillServer(search_server, corpus);
+		mt19937 generator(3);
+		vector<int> ids(search_server.begin(), search_server.end());
+		shuffle(ids.begin(), ids.end(), generator);
+		for (size_t i = 0; i < ids.size() / 3; ++i) {
+			search_server.RemoveDocument(ids[i]);
+		}
+		search_server.SaveSnapshot(path);
+
+		SearchServer loaded = SearchServer::LoadSnapshot(path);
+		AssertSameServers(loaded, search_server, corpus);
+
+		loaded.SetPostingFormat(format);
+		for (int i = 0; i < 100; ++i) {
+			loaded.RemoveDocument(ids[ids.size() / 3 + i]);
+			search_server.RemoveDocument(ids[ids.size() / 3 + i]);
+			AddCorpusDocument(loaded, corpus, ids[i]);
+			AddCorpusDocument(search_server, corpus, ids[i]);
+		}
+		AssertSameServers(loaded, search_server, corpus);
+	}
+	filesystem::remove(path);
+}
+
+// Частоты слов загруженных документов собираются при первом обращении: одновременные обращения
+// из нескольких потоков и из копии, пережившей загруженный сервер, дают те же словари
+void TestLazyWordFrequencies() {
+	const TestCorpus corpus = MakeCorpus(12, 3000);
+	SearchServer search_server("and in on"s);
+	FillServer(search_server, corpus);
+	const string path = GetSnapshotPath();
+	search_server.SaveSnapshot(path);
+	optional<SearchServer> loaded(SearchServer::LoadSnapshot(path));
+	filesystem::remove(path);
+
+	vector<thread> threads;
+	for (int thread_index = 0; thread_index < 4; ++thread_index) {
+		threads.emplace_back([&] {
+			for (const int document_id : search_server) {
+				ASSERT(loaded->GetWordFrequencies(document_id) == search_server.GetWordFrequencies(document_id));
+			}
+		});
+	}
+	for (thread& thread : threads) {
+		thread.join();
+	}
+
+	loaded->RemoveDocument(0);
+	const SearchServer copy = *loaded;
+	loaded.reset();
+	ASSERT(copy.GetWordFrequencies(0).empty());
+	for (const int document_id : search_server) {
+		if (document_id != 0) {
+			ASSERT(copy.GetWordFrequencies(document_id) == search_server.GetWordFrequencies(document_id));
+		}
+	}
+}
+
+// Каждое повреждение файла отвергается исключением до построения сервера
+void TestCorruptSnapshotIsRejected() {
+	SearchServer search_server("and"s);
+	search_server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+	search_server.AddDocument(2, "cat bird"s, DocumentStatus::BANNED, {2});
+	search_server.AddDocument(3, "fish bird"s, DocumentStatus::ACTUAL, {3});
+	const string path = GetSnapshotPath();
+	search_server.SaveSnapshot(path);
+	const vector<char> original = ReadFile(path);
+	ASSERT_EQUAL(SearchServer::LoadSnapshot(path).GetDocumentCount(), 3);
+
+	const auto assert_rejected = [&](const string& hint, auto corrupt) {
+		vector<char> data = original;
+		corrupt(data);
+		WriteFile(path, data);
+		try {
+			SearchServer::LoadSnapshot(path);
+		} catch (const runtime_error&) {
+			return;
+		}
+		ASSERT_HINT(false, hint);
+	};
+	assert_rejected("magic"s, [](vector<char>& data) {
+		data[0] = 'X';
+	});
+	assert_rejected("truncated"s, [](vector<char>& data) {
+		data.resize(data.size() / 2);
+	});
+	assert_rejected("header only"s, [](vector<char>& data) {
+		data.resize(40);
+	});
+	assert_rejected("decreasing posting offset"s, [](vector<char>& data) {
+		At<uint64_t>(data, At<uint64_t>(data, POSTING_OFFSETS_FIELD) + sizeof(uint64_t))
+			= At<uint64_t>(data, POSTING_COUNT_FIELD) + 1;
+	});
+	assert_rejected("posting count"s, [](vector<char>& data) {
+		At<uint64_t>(data, POSTING_COUNT_FIELD) -= 1;
+	});
+	assert_rejected("posting document index"s, [](vector<char>& data) {
+		At<uint32_t>(data, At<uint64_t>(data, POSTING_DOCUMENT_INDEXES_FIELD)) = At<uint64_t>(data, DOCUMENT_COUNT_FIELD);
+	});
+	assert_rejected("status"s, [](vector<char>& data) {
+		At<int32_t>(data, At<uint64_t>(data, DOCUMENT_STATUSES_FIELD)) = 7;
+	});
+	assert_rejected("negative status"s, [](vector<char>& data) {
+		At<int32_t>(data, At<uint64_t>(data, DOCUMENT_STATUSES_FIELD) + sizeof(int32_t)) = -1;
+	});
+	assert_rejected("repeated id"s, [](vector<char>& data) {
+		const size_t ids = At<uint64_t>(data, DOCUMENT_IDS_FIELD);
+		At<int32_t>(data, ids + sizeof(int32_t)) = At<int32_t>(data, ids);
+	});
+	assert_rejected("document count"s, [](vector<char>& data) {
+		At<uint64_t>(data, DOCUMENT_COUNT_FIELD) += 1;
+	});
+	ASSERT_THROWS(SearchServer::LoadSnapshot(path + ".missing"s), runtime_error);
+	filesystem::remove(path);
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestRoundTripWithRemovedDocuments);
+	RUN_TEST(TestLazyWordFrequencies);
+	RUN_TEST(TestCorruptSnapshotIsRejected);
+}
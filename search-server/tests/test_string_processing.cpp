@@ -0,0 +1,96 @@
+#include "search_server.h"
+#include "string_processing.h"
+#include "test_framework.h"
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Посимвольный разбор, с которым сравнивается ForEachWord
+vector<pair<string_view, bool>> SplitNaive(string_view text) {
+	vector<pair<string_view, bool>> words;
+	size_t word_begin = 0;
+	for (size_t i = 0; i <= text.size(); ++i) {
+		if (i == text.size() || text[i] == ' ') {
+			if (i > word_begin) {
+				const string_view word = text.substr(word_begin, i - word_begin);
+				words.push_back({word, none_of(word.begin(), word.end(), IsInvalidWordChar)});
+			}
+			word_begin = i + 1;
+		}
+	}
+	return words;
+}
+
+// Слова и признак корректности совпадают с посимвольным разбором при любом положении
+// пробелов и управляющих символов относительно границ участков по WORD_SCAN_WIDTH байт
+void TestForEachWordMatchesNaiveSplit() {
+	mt19937 generator(17);
+	const string alphabet = "ab  \x01\x1f\xd0\xb9\x7f-"s;
+	uniform_int_distribution<size_t> char_index(0, alphabet.size() - 1);
+	for (int round = 0; round < 3000; ++round) {
+		string text(round % 70, ' ');
+		for (char& c : text) {
+			c = alphabet[char_index(generator)];
+		}
+		vector<pair<string_view, bool>> words;
+		ForEachWord(text, [&words](string_view word, bool is_valid) {
+			words.push_back({word, is_valid});
+		});
+		ASSERT_HINT(words == SplitNaive(text), text);
+
+		vector<string_view> expected;
+		for (const auto& [word, _] : SplitNaive(text)) {
+			expected.push_back(word);
+		}
+		ASSERT_HINT(SplitIntoWords(text) == expected, text);
+	}
+}
+
+// Запрос с управляющим символом отклоняется во всех путях разбора, а байты UTF-8 допустимы
+void TestQueryValidation() {
+	SearchServer search_server("and"s);
+	search_server.AddDocument(1, "кот dog"s, DocumentStatus::ACTUAL, {1});
+	ASSERT_EQUAL(search_server.FindTopDocuments("кот"s).size(), 1u);
+	ASSERT_EQUAL(get<0>(search_server.MatchDocument("кот dog"s, 1)).size(), 2u);
+	for (const string& query : {"d\x01og"s, "dog -ca\x1ft"s, "\x10"s, "dog cat\x02"s}) {
+		ASSERT_THROWS(search_server.FindTopDocuments(query), invalid_argument);
+		ASSERT_THROWS(search_server.FindTopDocuments(execution::par, query), invalid_argument);
+		ASSERT_THROWS(search_server.MatchDocument(query, 1), invalid_argument);
+		ASSERT_THROWS(search_server.PrepareQuery(query), invalid_argument);
+	}
+	ASSERT_THROWS(search_server.AddDocument(2, "bad\x03 word"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+	ASSERT_THROWS(SearchServer("and \x05"s), invalid_argument);
+}
+
+// Повторные и крайние пробелы пропускаются: пустые слова не индексируются и не делают
+// запрос некорректным
+void TestRepeatedSpacesAreSkipped() {
+	SearchServer search_server("  and   in "s);
+	search_server.AddDocument(1, "  cat   in the    city  "s, DocumentStatus::ACTUAL, {1});
+	search_server.AddDocument(2, "dog"s, DocumentStatus::ACTUAL, {2});
+	const auto& frequencies = search_server.GetWordFrequencies(1);
+	ASSERT_EQUAL(frequencies.size(), 3u);
+	ASSERT_EQUAL(frequencies.count(""sv), 0u);
+	ASSERT_EQUAL(frequencies.at("cat"sv), 1.0 / 3);
+
+	ASSERT_SAME_DOCUMENTS(search_server.FindTopDocuments("   cat   city  "s), search_server.FindTopDocuments("cat city"s));
+	ASSERT_SAME_DOCUMENTS(search_server.FindTopDocuments("  dog  -cat "s), search_server.FindTopDocuments("dog -cat"s));
+	ASSERT(search_server.FindTopDocuments("   "s).empty());
+	ASSERT_EQUAL(get<0>(search_server.MatchDocument("  city    cat "s, 1)).size(), 2u);
+	ASSERT_EQUAL(search_server.PrepareQuery("  cat  cat   "s).GetServerId(), search_server.GetInstanceId());
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestForEachWordMatchesNaiveSplit);
+	RUN_TEST(TestQueryValidation);
+	RUN_TEST(TestRepeatedSpacesAreSkipped);
+}
@@ -0,0 +1,74 @@
+#include "term_dictionary.h"
+#include "search_server.h"
+#include "test_framework.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void TestInternAndFind() {
+	TermDictionary terms;
+	const TermId cat = terms.Intern("cat"sv);
+	const TermId dog = terms.Intern("dog"sv);
+	ASSERT(cat != dog);
+	ASSERT_EQUAL(terms.Intern("cat"sv), cat);
+	ASSERT_EQUAL(terms.Find("dog"sv), dog);
+	ASSERT_EQUAL(terms.Find("bird"sv), TermDictionary::NO_TERM);
+	ASSERT_EQUAL(terms.GetTerm(cat), "cat"sv);
+	ASSERT_EQUAL(terms.size(), 2u);
+}
+
+// Строки лежат в блоках, которые не перемещаются: ранее выданные string_view остаются
+// действительными, сколько бы слов ни добавилось потом, в том числе длиннее блока
+void TestTermViewsStayValid() {
+	TermDictionary terms;
+	vector<string> words;
+	for (int i = 0; i < 20000; ++i) {
+		words.push_back("word"s + to_string(i));
+	}
+	words.push_back(string(100000, 'x'));
+	vector<string_view> views;
+	for (const string& word : words) {
+		views.push_back(terms.GetTerm(terms.Intern(word)));
+	}
+	for (size_t i = 0; i < words.size(); ++i) {
+		ASSERT_EQUAL(views[i], words[i]);
+		ASSERT_EQUAL(terms.Find(words[i]), static_cast<TermId>(i));
+	}
+}
+
+// Копия видит слова оригинала, а новые слова копии и оригинала друг другу не видны
+void TestCopyIsIndependent() {
+	TermDictionary terms;
+	terms.Intern("cat"sv);
+	TermDictionary copy(terms);
+	const TermId dog = copy.Intern("dog"sv);
+	terms.Intern("bird"sv);
+	ASSERT_EQUAL(copy.Find("cat"sv), 0u);
+	ASSERT_EQUAL(copy.GetTerm(dog), "dog"sv);
+	ASSERT_EQUAL(copy.Find("bird"sv), TermDictionary::NO_TERM);
+	ASSERT_EQUAL(terms.Find("dog"sv), TermDictionary::NO_TERM);
+	ASSERT_EQUAL(terms.GetTerm(terms.Find("bird"sv)), "bird"sv);
+}
+
+// Слова, которых нет в индексе, не попадают в словарь и ни с чем не совпадают
+void TestUnknownQueryWords() {
+	SearchServer search_server("and"s);
+	search_server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+	ASSERT(search_server.FindTopDocuments("bird -fish"s).empty());
+	ASSERT_EQUAL(search_server.FindTopDocuments("cat bird -fish"s).size(), 1u);
+	ASSERT_EQUAL(search_server.GetDocumentFrequency("bird"s), 0);
+	ASSERT(get<0>(search_server.MatchDocument("bird"s, 1)).empty());
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestInternAndFind);
+	RUN_TEST(TestTermViewsStayValid);
+	RUN_TEST(TestCopyIsIndependent);
+	RUN_TEST(TestUnknownQueryWords);
+}
@@ -0,0 +1,141 @@
+#include "search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// Каждый индекс обрабатывается ровно один раз, а исключение не прерывает остальные индексы
+void TestParallelForCoversAllIndexes() {
+	ThreadPool pool(3);
+	for (const size_t count : {0, 1, 5, 100, 10000}) {
+		vector<atomic<int>> calls(count);
+		pool.ParallelFor(count, [&calls](size_t index, QueryContext&) {
+			++calls[index];
+		});
+		for (size_t i = 0; i < count; ++i) {
+			ASSERT_EQUAL_HINT(calls[i].load(), 1, to_string(i));
+		}
+	}
+
+	atomic<int> calls = 0;
+	ASSERT_THROWS(pool.ParallelFor(1000, [&calls](size_t index, QueryContext&) {
+		++calls;
+		if (index % 100 == 7) {
+			throw runtime_error("task failed"s);
+		}
+	}), runtime_error);
+	ASSERT_EQUAL(calls.load(), 1000);
+	ASSERT_THROWS(ThreadPool(0), invalid_argument);
+}
+
+// Вложенные ParallelFor не блокируют пул даже при одном рабочем
+void TestNestedParallelFor() {
+	for (const size_t worker_count : {1, 2, 4}) {
+		ThreadPool pool(worker_count);
+		vector<atomic<int>> sums(50);
+		pool.ParallelFor(sums.size(), [&](size_t outer, QueryContext&) {
+			pool.ParallelFor(100, [&](size_t inner, QueryContext&) {
+				sums[outer] += static_cast<int>(inner);
+			});
+		});
+		for (const auto& sum : sums) {
+			ASSERT_EQUAL(sum.load(), 4950);
+		}
+	}
+}
+
+#ifdef __linux__
+double GetProcessCpuSeconds() {
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// Рабочий, у которого не осталось задач, ждет вложенную группу во сне, а не в цикле:
+// пока другой рабочий выполняет долгую задачу, процесс почти не тратит процессорное время
+void TestNestedWaitSleeps() {
+	ThreadPool pool(2);
+	const double cpu_before = GetProcessCpuSeconds();
+	const auto start = chrono::steady_clock::now();
+	pool.ParallelFor(1, [&pool](size_t, QueryContext&) {
+		pool.ParallelFor(2, [](size_t index, QueryContext&) {
+			this_thread::sleep_for(index == 0 ? 400ms : 20ms);
+		});
+	});
+	const double wall_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	const double cpu_seconds = GetProcessCpuSeconds() - cpu_before;
+	ASSERT(wall_seconds >= 0.4);
+	ASSERT_HINT(cpu_seconds < 0.15, to_string(cpu_seconds));
+}
+
+// Закрепленные рабочие выполняются только на ядрах, доступных процессу
+void TestPinnedWorkersUseAllowedCpus() {
+	cpu_set_t allowed;
+	ASSERT(sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+	ThreadPool pool(CPU_COUNT(&allowed) + 2, true);
+	atomic<int> outside = 0;
+	pool.ParallelFor(1000, [&](size_t, QueryContext&) {
+		const int cpu = sched_getcpu();
+		if (cpu < 0 || !CPU_ISSET(cpu, &allowed)) {
+			++outside;
+		}
+	});
+	ASSERT_EQUAL(outside.load(), 0);
+}
+#endif
+
+// Задачи Post выполняются в пуле, в том числе поставленные прямо перед его разрушением
+void TestPostedTasksRun() {
+	atomic<int> calls = 0;
+	{
+		ThreadPool pool(2);
+		for (int i = 0; i < 50; ++i) {
+			pool.Post([&calls, payload = make_unique<int>(i)](QueryContext&) {
+				this_thread::sleep_for(1ms);
+				calls += *payload >= 0;
+			});
+		}
+	}
+	ASSERT_EQUAL(calls.load(), 50);
+}
+
+// Запросы через политику пула дают те же результаты, что и последовательные
+void TestPoolPolicyMatchesSequential() {
+	const TestCorpus corpus = MakeCorpus(81, 5000);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	ThreadPool pool(3);
+	for (const string& query : corpus.queries) {
+		ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(pool.GetPolicy(), query),
+			search_server.FindTopDocuments(query), query);
+	}
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestParallelForCoversAllIndexes);
+	RUN_TEST(TestNestedParallelFor);
+#ifdef __linux__
+	RUN_TEST(TestNestedWaitSleeps);
+	RUN_TEST(TestPinnedWorkersUseAllowedCpus);
+#endif
+	RUN_TEST(TestPostedTasksRun);
+	RUN_TEST(TestPoolPolicyMatchesSequential);
+}
@@ -0,0 +1,74 @@
+#include "top_documents.h"
+#include "search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Куча отбирает те же документы в том же порядке, что полная сортировка с обрезкой,
+// включая равные по релевантности документы с разным рейтингом
+void TestMatchesFullSort() {
+	mt19937 generator(1);
+	for (const size_t max_count : {0u, 1u, 5u, 17u, 1000u}) {
+		vector<Document> documents;
+		for (int i = 0; i < 500; ++i) {
+			// Мало различных значений, чтобы было много совпадений в пределах EPSILON
+			const double relevance = (generator() % 20) * 0.1 + (generator() % 2) * EPSILON / 4;
+			documents.push_back({i, relevance, i});
+		}
+		TopDocuments top_documents(max_count);
+		for (const Document& document : documents) {
+			top_documents.Add(document);
+		}
+		stable_sort(documents.begin(), documents.end(), IsMoreRelevant);
+		documents.resize(min(documents.size(), max_count));
+		ASSERT_SAME_DOCUMENTS(top_documents.Extract(), documents);
+	}
+}
+
+void TestThreshold() {
+	TopDocuments top_documents(2);
+	ASSERT(top_documents.GetThreshold() < -1e300);
+	top_documents.Add({1, 0.5, 0});
+	top_documents.Add({2, 0.7, 0});
+	ASSERT(top_documents.IsFull());
+	ASSERT(abs(top_documents.GetThreshold() - (0.5 - EPSILON)) < 1e-12);
+	top_documents.Reset(1);
+	ASSERT(!top_documents.IsFull());
+	top_documents.Add({3, 0.1, 0});
+	vector<Document> result;
+	top_documents.ExtractTo(result);
+	ASSERT_EQUAL(result.size(), 1u);
+	ASSERT_EQUAL(result[0].id, 3);
+}
+
+// max_count вызова задает размер результата во всех перегрузках
+void TestMaxCountParameter() {
+	const TestCorpus corpus = MakeCorpus(3, 500);
+	SearchServer search_server("and"s);
+	FillServer(search_server, corpus);
+	for (const string& query : corpus.queries) {
+		const auto all = search_server.FindTopDocuments(query, DocumentFilter(), 1000);
+		for (const size_t max_count : {0u, 1u, 3u, 50u}) {
+			vector<Document> expected(all.begin(), all.begin() + min(all.size(), max_count));
+			ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(query, DocumentFilter(), max_count), expected, query);
+			ASSERT_SAME_DOCUMENTS_HINT(search_server.FindTopDocuments(execution::par, query, DocumentFilter(), max_count),
+				expected, query);
+		}
+		ASSERT(search_server.FindTopDocuments(query).size() <= static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+	}
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestMatchesFullSort);
+	RUN_TEST(TestThreshold);
+	RUN_TEST(TestMaxCountParameter);
+}
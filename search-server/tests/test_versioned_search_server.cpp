@@ -0,0 +1,119 @@
+#include "versioned_search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+constexpr int BATCH_SIZE = 200;
+constexpr int BATCH_COUNT = 10;
+
+// Пакет добавляет BATCH_SIZE документов и удаляет первый документ предыдущего пакета,
+// чтобы копии версий проходили и через удаление
+void AddBatch(SearchServer& search_server, const TestCorpus& corpus, int batch) {
+	vector<NewDocument> documents;
+	for (int document_id = batch * BATCH_SIZE; document_id < (batch + 1) * BATCH_SIZE; ++document_id) {
+		documents.push_back(MakeCorpusDocument(corpus, document_id));
+	}
+	search_server.AddDocuments(documents);
+	if (batch > 0) {
+		search_server.RemoveDocument((batch - 1) * BATCH_SIZE);
+	}
+}
+
+// Число примененных пакетов по числу документов версии
+size_t GetBatchCount(const SearchServer& search_server) {
+	return (search_server.GetDocumentCount() + BATCH_SIZE - 1) / BATCH_SIZE;
+}
+
+// Опубликованная версия не меняется после следующих изменений и после неудачного изменения
+void TestPublishedVersionIsImmutable() {
+	const TestCorpus corpus = MakeCorpus(61, BATCH_SIZE * 2);
+	VersionedSearchServer versioned(SearchServer("and"s));
+	versioned.Modify([&](SearchServer& search_server) {
+		AddBatch(search_server, corpus, 0);
+	});
+	const auto first = versioned.GetSnapshot();
+	vector<vector<Document>> first_results;
+	for (const string& query : corpus.queries) {
+		first_results.push_back(first->FindTopDocuments(query));
+	}
+
+	ASSERT_THROWS(versioned.Modify([](SearchServer& search_server) {
+		search_server.RemoveDocument(1);
+		search_server.AddDocument(-5, "bad"s, DocumentStatus::ACTUAL, {});
+	}), invalid_argument);
+	ASSERT_EQUAL(versioned.GetVersion(), 1u);
+	ASSERT(versioned.GetSnapshot() == first);
+
+	versioned.Modify([&](SearchServer& search_server) {
+		AddBatch(search_server, corpus, 1);
+	});
+	ASSERT_EQUAL(versioned.GetVersion(), 2u);
+	ASSERT_EQUAL(first->GetDocumentCount(), BATCH_SIZE);
+	ASSERT_EQUAL(versioned.GetSnapshot()->GetDocumentCount(), 2 * BATCH_SIZE - 1);
+	for (size_t i = 0; i < corpus.queries.size(); ++i) {
+		ASSERT_SAME_DOCUMENTS_HINT(first->FindTopDocuments(corpus.queries[i]), first_results[i], corpus.queries[i]);
+	}
+}
+
+// Читатели во время записи всегда видят целую версию: ответы совпадают с последовательно
+// построенным сервером с тем же числом пакетов
+void TestReadersSeeWholeVersions() {
+	const TestCorpus corpus = MakeCorpus(62, BATCH_SIZE * BATCH_COUNT);
+	vector<vector<vector<Document>>> expected(BATCH_COUNT + 1);
+	SearchServer reference("and"s);
+	for (int batch = 0; batch <= BATCH_COUNT; ++batch) {
+		for (const string& query : corpus.queries) {
+			expected[batch].push_back(reference.FindTopDocuments(query));
+		}
+		if (batch < BATCH_COUNT) {
+			AddBatch(reference, corpus, batch);
+		}
+	}
+
+	VersionedSearchServer versioned(SearchServer("and"s));
+	atomic<bool> is_writing = true;
+	atomic<int> checks = 0;
+	vector<thread> readers;
+	for (size_t reader = 0; reader < 3; ++reader) {
+		readers.emplace_back([&, reader] {
+			size_t query_index = reader;
+			do {
+				const auto snapshot = versioned.GetSnapshot();
+				const size_t i = query_index++ % corpus.queries.size();
+				ASSERT_SAME_DOCUMENTS_HINT(snapshot->FindTopDocuments(corpus.queries[i]),
+					expected[GetBatchCount(*snapshot)][i], corpus.queries[i]);
+				++checks;
+			} while (is_writing);
+		});
+	}
+	for (int batch = 0; batch < BATCH_COUNT; ++batch) {
+		versioned.Modify([&](SearchServer& search_server) {
+			AddBatch(search_server, corpus, batch);
+		});
+	}
+	is_writing = false;
+	for (thread& reader : readers) {
+		reader.join();
+	}
+	ASSERT_EQUAL(versioned.GetVersion(), static_cast<uint64_t>(BATCH_COUNT));
+	ASSERT(checks > 0);
+	for (size_t i = 0; i < corpus.queries.size(); ++i) {
+		ASSERT_SAME_DOCUMENTS(versioned.GetSnapshot()->FindTopDocuments(corpus.queries[i]), expected[BATCH_COUNT][i]);
+	}
+}
+
+}  // namespace
+
+int main() {
+	RUN_TEST(TestPublishedVersionIsImmutable);
+	RUN_TEST(TestReadersSeeWholeVersions);
+}
@@ -0,0 +1,215 @@
+#include "thread_pool.h"
+
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t worker_count, bool pin_workers) {
+	if (worker_count == 0) {
+		throw invalid_argument("Worker count must be positive"s);
+	}
+	workers_.reserve(worker_count);
+	for (size_t i = 0; i < worker_count; ++i) {
+		workers_.push_back(make_unique<Worker>());
+	}
+	// Номера ядер могут идти с пропусками (cgroups, taskset), поэтому рабочие закрепляются
+	// только за ядрами из маски процесса
+	vector<int> allowed_cpus;
+#ifdef __linux__
+	cpu_set_t process_cpus;
+	if (pin_workers && sched_getaffinity(0, sizeof(process_cpus), &process_cpus) == 0) {
+		for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+			if (CPU_ISSET(cpu, &process_cpus)) {
+				allowed_cpus.push_back(cpu);
+			}
+		}
+	}
+#else
+	(void)pin_workers;
+#endif
+	for (size_t i = 0; i < worker_count; ++i) {
+		workers_[i]->thread = thread([this, i] {
+			WorkerLoop(i);
+		});
+#ifdef __linux__
+		if (!allowed_cpus.empty()) {
+			cpu_set_t cpus;
+			CPU_ZERO(&cpus);
+			CPU_SET(allowed_cpus[i % allowed_cpus.size()], &cpus);
+			pthread_setaffinity_np(workers_[i]->thread.native_handle(), sizeof(cpus), &cpus);
+		}
+#endif
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		lock_guard lock(wake_mutex_);
+		stop_ = true;
+	}
+	wake_.notify_all();
+	for (auto& worker : workers_) {
+		worker->thread.join();
+	}
+}
+
+ThreadPool& ThreadPool::GetDefault() {
+	static ThreadPool pool;
+	return pool;
+}
+
+size_t ThreadPool::GetCurrentWorker() const {
+	return current_pool == this ? current_worker : NOT_WORKER;
+}
+
+void ThreadPool::Submit(const vector<Task>& tasks) {
+	// Рабочий кладет задачи себе: остальные заберут их, если освободятся раньше.
+	// Задачи из внешнего потока раскладываются по всем очередям
+	const size_t current = GetCurrentWorker();
+	if (current != NOT_WORKER) {
+		Worker& worker = *workers_[current];
+		lock_guard lock(worker.mutex);
+		worker.tasks.insert(worker.tasks.end(), tasks.begin(), tasks.end());
+		queued_.fetch_add(tasks.size());
+	} else {
+		const size_t first_worker = next_worker_.fetch_add(1, memory_order_relaxed);
+		for (size_t i = 0; i < tasks.size(); ++i) {
+			Worker& worker = *workers_[(first_worker + i) % workers_.size()];
+			lock_guard lock(worker.mutex);
+			worker.tasks.push_back(tasks[i]);
+			queued_.fetch_add(1);
+		}
+	}
+	{
+		lock_guard lock(wake_mutex_);
+	}
+	wake_.notify_all();
+}
+
+void ThreadPool::Wait(TaskGroup& group) {
+	const size_t current = GetCurrentWorker();
+	if (current != NOT_WORKER) {
+		while (group.pending.load() > 0) {
+			if (RunOne(current)) {
+				continue;
+			}
+			// Оставшиеся задачи группы уже выполняют другие рабочие
+			unique_lock lock(wake_mutex_);
+			wake_.wait(lock, [this, &group] {
+				return group.pending.load() == 0 || queued_.load() > 0;
+			});
+		}
+	}
+	// Последняя задача уменьшает счетчик под мьютексом группы: дождавшись его,
+	// можно уничтожать группу
+	unique_lock lock(group.mutex);
+	group.done.wait(lock, [&group] {
+		return group.pending.load() == 0;
+	});
+}
+
+bool ThreadPool::TryPop(size_t worker, Task& task) {
+	{
+		Worker& own = *workers_[worker];
+		lock_guard lock(own.mutex);
+		if (!own.tasks.empty()) {
+			task = own.tasks.back();
+			own.tasks.pop_back();
+			queued_.fetch_sub(1);
+			return true;
+		}
+	}
+	for (size_t i = 1; i < workers_.size(); ++i) {
+		Worker& victim = *workers_[(worker + i) % workers_.size()];
+		lock_guard lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = victim.tasks.front();
+			victim.tasks.pop_front();
+			queued_.fetch_sub(1);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ThreadPool::RunOne(size_t worker) {
+	Task task;
+	if (!TryPop(worker, task)) {
+		return false;
+	}
+	Run(worker, task);
+	return true;
+}
+
+void ThreadPool::Run(size_t worker, const Task& task) {
+	vector<unique_ptr<QueryContext>>& contexts = workers_[worker]->contexts;
+	unique_ptr<QueryContext> context;
+	if (contexts.empty()) {
+		context = make_unique<QueryContext>();
+	} else {
+		context = move(contexts.back());
+		contexts.pop_back();
+	}
+
+	if (task.group == nullptr) {
+		task.invoke(task.function, task.begin, *context);
+		context->TrimDenseBuffers();
+		contexts.push_back(move(context));
+		return;
+	}
+
+	TaskGroup& group = *task.group;
+	for (size_t index = task.begin; index < task.end; ++index) {
+		try {
+			task.invoke(task.function, index, *context);
+		} catch (...) {
+			lock_guard lock(group.mutex);
+			if (!group.error) {
+				group.error = current_exception();
+			}
+		}
+	}
+	context->TrimDenseBuffers();
+	contexts.push_back(move(context));
+
+	lock_guard lock(group.mutex);
+	if (group.pending.fetch_sub(1) == 1) {
+		group.done.notify_all();
+		if (group.is_waited_by_worker) {
+			{
+				lock_guard wake_lock(wake_mutex_);
+			}
+			wake_.notify_all();
+		}
+	}
+}
+
+void ThreadPool::WorkerLoop(size_t worker) {
+	current_pool = this;
+	current_worker = worker;
+	while (true) {
+		if (RunOne(worker)) {
+			continue;
+		}
+		unique_lock lock(wake_mutex_);
+		wake_.wait(lock, [this] {
+			return stop_ || queued_.load() > 0;
+		});
+		if (stop_ && queued_.load() == 0) {
+			return;
+		}
+	}
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "query_context.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <execution>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков для пакетной обработки запросов. У каждого рабочего своя очередь задач:
+// свои задачи он берет с конца, а закончив их, забирает задачи с начала чужих очередей,
+// так что дорогие запросы не задерживают весь пакет на одном потоке.
+// Каждый рабочий хранит контексты запросов и отдает их задачам повторно.
+//
+// Вложенный ParallelFor из задачи того же пула не блокирует рабочего: пока вложенные
+// задачи не выполнены, он выполняет задачи из своей очереди или забирает чужие, а если
+// задач нет, спит до появления новых или до завершения своих вложенных задач.
+class ThreadPool {
+public:
+	// Политика выполнения для параллельных методов SearchServer: работа раздается задачами пула
+	struct Policy {
+		ThreadPool& pool;
+	};
+
+	// pin_workers - закрепить рабочих по кругу за ядрами, доступными процессу
+	// по sched_getaffinity (только Linux)
+	explicit ThreadPool(size_t worker_count = std::max(1u, std::thread::hardware_concurrency()), bool pin_workers = false);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	size_t GetWorkerCount() const {
+		return workers_.size();
+	}
+
+	Policy GetPolicy() {
+		return {*this};
+	}
+
+	// Вызывает function(index, context) для каждого index из [0, count) и ждет завершения.
+	// context принадлежит рабочему и не используется другими задачами во время вызова.
+	// Первое исключение из function пробрасывается после завершения остальных вызовов
+	template <typename Function>
+	void ParallelFor(size_t count, Function function);
+
+	// Ставит function(context) в очередь пула и сразу возвращает управление. Ошибки задача
+	// обрабатывает сама: исключение из function завершает программу. Задачи, поставленные
+	// до разрушения пула, выполняются до его завершения
+	template <typename Function>
+	void Post(Function function);
+
+	// Общий пул с потоком на каждое ядро; создается при первом обращении
+	static ThreadPool& GetDefault();
+
+private:
+	static constexpr size_t TASKS_PER_WORKER = 8;
+
+	struct TaskGroup {
+		std::atomic<size_t> pending{0};
+		std::mutex mutex;
+		std::condition_variable done;
+		std::exception_ptr error;
+		// Группу ждет рабочий пула: завершение группы должно разбудить его через wake_
+		bool is_waited_by_worker = false;
+	};
+
+	// Отрезок индексов одного ParallelFor; function указывает на функтор в его кадре стека.
+	// У задачи Post группы нет, а функтор лежит в куче и удаляется после вызова
+	struct Task {
+		TaskGroup* group;
+		size_t begin;
+		size_t end;
+		void (*invoke)(void* function, size_t index, QueryContext& context);
+		void* function;
+	};
+
+	struct Worker {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+		// Трогает только поток рабочего; больше одного контекста нужно только для вложенных задач
+		std::vector<std::unique_ptr<QueryContext>> contexts;
+		std::thread thread;
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers_;
+	std::atomic<size_t> queued_{0};
+	std::atomic<size_t> next_worker_{0};
+	std::mutex wake_mutex_;
+	std::condition_variable wake_;
+	bool stop_ = false;
+
+	template <typename Function>
+	static void Invoke(void* function, size_t index, QueryContext& context) {
+		(*static_cast<Function*>(function))(index, context);
+	}
+
+	template <typename Function>
+	static void InvokePosted(void* function, size_t, QueryContext& context) {
+		std::unique_ptr<Function> posted(static_cast<Function*>(function));
+		(*posted)(context);
+	}
+
+	// Номер рабочего этого пула в текущем потоке или NOT_WORKER
+	static constexpr size_t NOT_WORKER = static_cast<size_t>(-1);
+	size_t GetCurrentWorker() const;
+
+	void Submit(const std::vector<Task>& tasks);
+	void Wait(TaskGroup& group);
+	bool TryPop(size_t worker, Task& task);
+	bool RunOne(size_t worker);
+	void Run(size_t worker, const Task& task);
+	void WorkerLoop(size_t worker);
+};
+
+template <typename Function>
+void ThreadPool::ParallelFor(size_t count, Function function) {
+	if (count == 0) {
+		return;
+	}
+	TaskGroup group;
+	const size_t task_count = std::min(count, workers_.size() * TASKS_PER_WORKER);
+	std::vector<Task> tasks(task_count);
+	for (size_t i = 0; i < task_count; ++i) {
+		tasks[i] = {&group, count * i / task_count, count * (i + 1) / task_count, &Invoke<Function>, &function};
+	}
+	group.pending.store(task_count);
+	group.is_waited_by_worker = GetCurrentWorker() != NOT_WORKER;
+	Submit(tasks);
+	Wait(group);
+	if (group.error) {
+		std::rethrow_exception(group.error);
+	}
+}
+
+template <typename Function>
+void ThreadPool::Post(Function function) {
+	auto posted = std::make_unique<Function>(std::move(function));
+	Submit({Task{nullptr, 0, 1, &InvokePosted<Function>, posted.get()}});
+	posted.release();
+}
+
+// std::for_each с политикой выполнения стандартной библиотеки или пула
+template <class ExecutionPolicy, typename Iterator, typename Function>
+void ForEach(ExecutionPolicy policy, Iterator first, Iterator last, Function function) {
+	std::for_each(policy, first, last, function);
+}
+
+template <typename Iterator, typename Function>
+void ForEach(ThreadPool::Policy policy, Iterator first, Iterator last, Function function) {
+	policy.pool.ParallelFor(last - first, [&](size_t index, QueryContext&) {
+		function(first[index]);
+	});
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "document.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+const int MAX_RESULT_DOCUMENT_COUNT = 5;
+const double EPSILON = 1e-6;
+
+inline bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+	if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
+		return lhs.rating > rhs.rating;
+	} else {
+		return lhs.relevance > rhs.relevance;
+	}
+}
+
+// Хранит не больше max_count лучших документов. На вершине кучи - худший из отобранных,
+// поэтому новый кандидат сравнивается только с ним.
+class TopDocuments {
+public:
+	explicit TopDocuments(size_t max_count)
+		: max_count_(max_count) {
+	}
+
+	void Add(const Document& document) {
+		if (heap_.size() < max_count_) {
+			heap_.push_back(document);
+			std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+		} else if (max_count_ > 0 && IsMoreRelevant(document, heap_.front())) {
+			std::pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+			heap_.back() = document;
+			std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+		}
+	}
+
+	size_t GetMaxCount() const {
+		return max_count_;
+	}
+
+	bool IsFull() const {
+		return heap_.size() >= max_count_;
+	}
+
+	// Документ с релевантностью не выше порога в отбор уже не попадет
+	double GetThreshold() const {
+		if (!IsFull()) {
+			return -std::numeric_limits<double>::infinity();
+		}
+		return max_count_ == 0 ? std::numeric_limits<double>::infinity() : heap_.front().relevance - EPSILON;
+	}
+
+	std::vector<Document> Extract() {
+		std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+		return std::move(heap_);
+	}
+
+	// Очищает отбор без освобождения памяти
+	void Reset(size_t max_count) {
+		max_count_ = max_count;
+		heap_.clear();
+	}
+
+	// Копирует отобранные документы в result, сохраняя буфер кучи для следующего отбора
+	void ExtractTo(std::vector<Document>& result) {
+		std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+		result.assign(heap_.begin(), heap_.end());
+		heap_.clear();
+	}
+
+private:
+	size_t max_count_;
+	std::vector<Document> heap_;
+};
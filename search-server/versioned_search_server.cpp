@@ -0,0 +1,15 @@
+#include "versioned_search_server.h"
+
+using namespace std;
+
+VersionedSearchServer::VersionedSearchServer(SearchServer search_server)
+	: current_(make_shared<const SearchServer>(move(search_server))) {
+}
+
+shared_ptr<const SearchServer> VersionedSearchServer::GetSnapshot() const {
+	return atomic_load(&current_);
+}
+
+uint64_t VersionedSearchServer::GetVersion() const {
+	return version_.load(memory_order_acquire);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// Запросы во время обновления индекса. Читатели берут опубликованную версию сервера
+// и работают с ней без блокировок: версия неизменяема. Писатель копирует текущую версию,
+// применяет к копии пакет изменений и атомарно публикует результат. Старая версия
+// освобождается, когда ее отпустит последний читатель.
+//
+// Копия делит с оригиналом списки вхождений, частоты слов документов, блоки словаря и текстов;
+// заново копируются только измененные списки и таблицы, пропорциональные числу документов
+// и слов. Поэтому изменения выгоднее применять пакетами, а не по одному документу.
+class VersionedSearchServer {
+public:
+	explicit VersionedSearchServer(SearchServer search_server);
+
+	// Версия остается действительной, пока жив указатель, даже после публикации следующей
+	std::shared_ptr<const SearchServer> GetSnapshot() const;
+
+	// Число опубликованных изменений
+	uint64_t GetVersion() const;
+
+	// update(SearchServer&) получает копию текущей версии. Если update бросит исключение,
+	// опубликованная версия не меняется. Писатели выполняются по очереди
+	template <typename Update>
+	void Modify(Update update);
+
+private:
+	// Доступ к указателю только через std::atomic_load/std::atomic_store
+	std::shared_ptr<const SearchServer> current_;
+	std::atomic<uint64_t> version_{0};
+	std::mutex write_mutex_;
+};
+
+template <typename Update>
+void VersionedSearchServer::Modify(Update update) {
+	std::lock_guard guard(write_mutex_);
+	auto next = std::make_shared<SearchServer>(*std::atomic_load(&current_));
+	update(*next);
+	std::atomic_store(&current_, std::shared_ptr<const SearchServer>(std::move(next)));
+	version_.fetch_add(1, std::memory_order_release);
+}